@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Timed actuator control for SAUL devices.
+ *
+ * Ramps and coalesced writes are executed by a dedicated thread that runs at
+ * a fixed rate (ACTUATOR_RATE_HZ), independently of the interpreter. Lua only
+ * sets the goal, so the motion is not affected by the garbage collector or by
+ * the cost of crossing into C on every step.
+ *
+ * A write is only issued when the converted value differs from the last one
+ * applied to the device, and updates sent faster than the tick rate are
+ * collapsed into one.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+#include "saul_reg.h"
+#include "lua_saul.h"
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+#ifndef ACTUATOR_RATE_HZ
+#define ACTUATOR_RATE_HZ (100)
+#endif
+
+/* Maximum number of devices being driven at the same time. */
+#ifndef ACTUATOR_SLOTS
+#define ACTUATOR_SLOTS (4)
+#endif
+
+#ifndef ACTUATOR_PRIO
+#define ACTUATOR_PRIO (THREAD_PRIORITY_MAIN - 1)
+#endif
+
+#define ACTUATOR_PERIOD_US (US_PER_SEC / ACTUATOR_RATE_HZ)
+
+enum ACT_STATE { ACT_IDLE, ACT_PENDING, ACT_RAMP };
+
+enum ACT_CURVE { CURVE_LINEAR, CURVE_EASE_IN, CURVE_EASE_OUT, CURVE_SMOOTH };
+
+static const char *const curve_names[] = {
+    "linear", "ease_in", "ease_out", "smooth", NULL
+};
+
+typedef struct {
+    saul_reg_t *dev;            /**< NULL if the slot is free */
+    uint8_t state;
+    uint8_t curve;
+    uint8_t dim;
+    bool has_last;
+    float from[PHYDAT_DIM];
+    float to[PHYDAT_DIM];
+    uint32_t start;
+    uint32_t duration;
+    phydat_t last;              /**< Last value written to the device */
+} act_slot_t;
+
+static act_slot_t slots[ACTUATOR_SLOTS];
+
+static struct {
+    uint32_t writes;            /**< Calls to saul_reg_write */
+    uint32_t skipped;           /**< Ticks where the value did not change */
+    uint32_t coalesced;         /**< Updates overwritten before being applied */
+    uint32_t errors;
+} stats;
+
+static mutex_t lock = MUTEX_INIT;
+static mutex_t wakeup = MUTEX_INIT_LOCKED;
+static kernel_pid_t act_pid = KERNEL_PID_UNDEF;
+static char act_stack[THREAD_STACKSIZE_DEFAULT];
+
+static float _apply_curve(uint8_t curve, float x)
+{
+    switch (curve) {
+        case CURVE_EASE_IN:
+            return x * x;
+        case CURVE_EASE_OUT:
+            return 1 - (1 - x) * (1 - x);
+        case CURVE_SMOOTH:
+            return x * x * (3 - 2 * x);
+        case CURVE_LINEAR: /* falls through */
+        default:
+            return x;
+    }
+}
+
+/**
+ * Compute the value of a slot for this tick.
+ *
+ * Must be called with the lock held.
+ *
+ * @return  true if the slot must be written.
+ */
+static bool _step(act_slot_t *s, uint32_t now, phydat_t *data)
+{
+    float v[PHYDAT_DIM];
+    unsigned int i;
+
+    if (s->state == ACT_RAMP) {
+        uint32_t elapsed = now - s->start;
+        float k = (elapsed >= s->duration) ? 1.0f
+                  : _apply_curve(s->curve, (float)elapsed / s->duration);
+
+        for (i = 0; i < s->dim; i++) {
+            v[i] = s->from[i] + (s->to[i] - s->from[i]) * k;
+        }
+
+        if (elapsed >= s->duration) {
+            s->state = ACT_IDLE;
+        }
+    } else {
+        memcpy(v, s->to, sizeof(v));
+        s->state = ACT_IDLE;
+    }
+
+    lua_saul_float2phydat(v, s->dim, data);
+
+    if (s->has_last && !memcmp(data->val, s->last.val, sizeof(data->val))
+        && data->scale == s->last.scale) {
+        stats.skipped++;
+        return false;
+    }
+
+    s->last = *data;
+    s->has_last = true;
+
+    return true;
+}
+
+static void *_actuator_thread(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        xtimer_ticks32_t last_wakeup;
+        bool active;
+
+        mutex_lock(&wakeup);
+        last_wakeup = xtimer_now();
+
+        do {
+            unsigned int i;
+            uint32_t now = xtimer_now_usec();
+
+            active = false;
+
+            for (i = 0; i < ACTUATOR_SLOTS; i++) {
+                act_slot_t *s = &slots[i];
+                saul_reg_t *dev = NULL;
+                phydat_t data;
+
+                mutex_lock(&lock);
+                if (s->dev != NULL && s->state != ACT_IDLE) {
+                    if (_step(s, now, &data)) {
+                        dev = s->dev;
+                    }
+                    active |= (s->state != ACT_IDLE);
+                }
+                mutex_unlock(&lock);
+
+                if (dev != NULL) {
+                    stats.writes++;
+                    if (saul_reg_write(dev, &data) < 0) {
+                        stats.errors++;
+                    }
+                }
+            }
+
+            if (active) {
+                xtimer_periodic_wakeup(&last_wakeup, ACTUATOR_PERIOD_US);
+            }
+        } while (active);
+    }
+
+    return NULL;
+}
+
+/**
+ * Find the slot for a device, allocating a new one if needed.
+ *
+ * Must be called with the lock held.
+ */
+static act_slot_t *_get_slot(saul_reg_t *dev)
+{
+    unsigned int i;
+    act_slot_t *free_slot = NULL, *idle_slot = NULL;
+
+    for (i = 0; i < ACTUATOR_SLOTS; i++) {
+        if (slots[i].dev == dev) {
+            return &slots[i];
+        } else if (slots[i].dev == NULL) {
+            free_slot = (free_slot == NULL) ? &slots[i] : free_slot;
+        } else if (slots[i].state == ACT_IDLE) {
+            idle_slot = (idle_slot == NULL) ? &slots[i] : idle_slot;
+        }
+    }
+
+    /* Evicting an idle slot only loses the last value written to it */
+    if (free_slot == NULL) {
+        free_slot = idle_slot;
+    }
+
+    if (free_slot != NULL) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->dev = dev;
+    }
+
+    return free_slot;
+}
+
+static void _start_thread(lua_State *L)
+{
+    if (act_pid == KERNEL_PID_UNDEF) {
+        act_pid = thread_create(act_stack, sizeof(act_stack), ACTUATOR_PRIO,
+                                THREAD_CREATE_STACKTEST, _actuator_thread,
+                                NULL, "actuator");
+        if (act_pid < 0) {
+            act_pid = KERNEL_PID_UNDEF;
+            luaL_error(L, "Cannot start actuator thread");
+        }
+    }
+}
+
+/**
+ * Read the target values from the stack (a number or a table of numbers).
+ *
+ * @return  Number of values.
+ */
+static int _check_values(lua_State *L, int arg, float *values)
+{
+    int n, i;
+
+    if (lua_type(L, arg) != LUA_TTABLE) {
+        values[0] = luaL_checknumber(L, arg);
+        return 1;
+    }
+
+    n = lua_rawlen(L, arg);
+    luaL_argcheck(L, n > 0 && n <= PHYDAT_DIM, arg, "Expected 1 to 3 values");
+
+    for (i = 0; i < n; i++) {
+        int isnum;
+
+        lua_rawgeti(L, arg, i + 1);
+        values[i] = lua_tonumberx(L, -1, &isnum);
+        lua_pop(L, 1);
+        luaL_argcheck(L, isnum, arg, "Values must be numbers");
+    }
+
+    return n;
+}
+
+static act_slot_t *_check_slot(lua_State *L, saul_reg_t *dev)
+{
+    act_slot_t *s = _get_slot(dev);
+
+    if (s == NULL) {
+        mutex_unlock(&lock);
+        luaL_error(L, "Too many actuators in use");
+    }
+
+    return s;
+}
+
+/**
+ * Move an actuator smoothly to a target value.
+ *
+ * The starting point is the last value written to the device (with write,
+ * ramp or write_coalesced), or the result of reading the device. If neither is available the device jumps
+ * to the target.
+ *
+ * The function returns immediately. Use busy() to know when the ramp is
+ * finished.
+ *
+ * @param   dev         SAUL device object.
+ * @param   target      Number, or table with up to three numbers.
+ * @param   duration_ms Duration of the ramp.
+ * @param   curve       (optional) "linear" (default), "ease_in", "ease_out"
+ *                      or "smooth".
+ */
+int lua_saul_ramp(lua_State *L)
+{
+    saul_reg_t *dev = lua_saul_checkdev(L, 1);
+    float target[PHYDAT_DIM], from[PHYDAT_DIM];
+    int dim = _check_values(L, 2, target);
+    lua_Integer duration = luaL_checkinteger(L, 3);
+    int curve = luaL_checkoption(L, 4, "linear", curve_names);
+    phydat_t current;
+    int nread, known = 0, i;
+    act_slot_t *s;
+
+    luaL_argcheck(L, duration >= 0 && duration <= UINT32_MAX / US_PER_MS, 3,
+                  "Duration out of range");
+    _start_thread(L);
+
+    mutex_lock(&lock);
+    s = _check_slot(L, dev);
+    if (s->has_last) {
+        known = lua_saul_phydat2float(&s->last, dim, from);
+    }
+    mutex_unlock(&lock);
+
+    /* The read can be slow, so it must not block the actuator thread */
+    if (!known) {
+        current.scale = 0;
+        nread = saul_reg_read(dev, &current);
+        if (nread > 0) {
+            known = lua_saul_phydat2float(&current, (nread < dim) ? nread : dim,
+                                          from);
+        }
+    }
+
+    mutex_lock(&lock);
+    s = _check_slot(L, dev);
+
+    for (i = 0; i < dim; i++) {
+        s->from[i] = (i < known) ? from[i] : target[i];
+        s->to[i] = target[i];
+    }
+
+    if (s->state == ACT_PENDING) {
+        stats.coalesced++;
+    }
+    s->dim = dim;
+    s->curve = curve;
+    s->start = xtimer_now_usec();
+    s->duration = duration * US_PER_MS;
+    s->state = ACT_RAMP;
+    mutex_unlock(&lock);
+
+    mutex_unlock(&wakeup);
+
+    return 0;
+}
+
+/**
+ * Write to an actuator asynchronously.
+ *
+ * The value is applied at the next tick of the actuator thread. If several
+ * values are written before that, only the last one is applied. Writing
+ * cancels a ramp in progress.
+ *
+ * @param   dev     SAUL device object.
+ * @param   ...     Up to three numbers.
+ */
+int lua_saul_write_coalesced(lua_State *L)
+{
+    saul_reg_t *dev = lua_saul_checkdev(L, 1);
+    int i, dim = lua_gettop(L) - 1;
+    float values[PHYDAT_DIM];
+    act_slot_t *s;
+
+    luaL_argcheck(L, dim > 0 && dim <= PHYDAT_DIM, 2, "Expected 1 to 3 values");
+
+    for (i = 0; i < dim; i++) {
+        values[i] = luaL_checknumber(L, i + 2);
+    }
+
+    _start_thread(L);
+
+    mutex_lock(&lock);
+    s = _check_slot(L, dev);
+
+    if (s->state != ACT_IDLE) {
+        stats.coalesced++;
+    }
+    memcpy(s->to, values, sizeof(values));
+    s->dim = dim;
+    s->state = ACT_PENDING;
+    mutex_unlock(&lock);
+
+    mutex_unlock(&wakeup);
+
+    return 0;
+}
+
+void lua_saul_actuator_written(saul_reg_t *dev, const phydat_t *data)
+{
+    unsigned int i;
+
+    mutex_lock(&lock);
+    for (i = 0; i < ACTUATOR_SLOTS; i++) {
+        if (slots[i].dev == dev) {
+            if (data != NULL) {
+                slots[i].last = *data;
+                slots[i].has_last = true;
+            } else {
+                slots[i].has_last = false;
+            }
+        }
+    }
+    mutex_unlock(&lock);
+}
+
+/**
+ * Check if the device has a ramp or write in progress.
+ *
+ * @return  boolean
+ */
+int lua_saul_busy(lua_State *L)
+{
+    saul_reg_t *dev = lua_saul_checkdev(L, 1);
+    unsigned int i;
+    bool busy = false;
+
+    mutex_lock(&lock);
+    for (i = 0; i < ACTUATOR_SLOTS; i++) {
+        if (slots[i].dev == dev && slots[i].state != ACT_IDLE) {
+            busy = true;
+        }
+    }
+    mutex_unlock(&lock);
+
+    lua_pushboolean(L, busy);
+
+    return 1;
+}
+
+/**
+ * Get actuator thread statistics.
+ *
+ * @return  Table with fields writes, skipped (redundant values not written),
+ *          coalesced (updates replaced before being applied) and errors.
+ */
+int lua_saul_actuator_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 4);
+
+    lua_pushinteger(L, stats.writes);
+    lua_setfield(L, -2, "writes");
+    lua_pushinteger(L, stats.skipped);
+    lua_setfield(L, -2, "skipped");
+    lua_pushinteger(L, stats.coalesced);
+    lua_setfield(L, -2, "coalesced");
+    lua_pushinteger(L, stats.errors);
+    lua_setfield(L, -2, "errors");
+
+    return 1;
+}
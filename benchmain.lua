@@ -0,0 +1,8 @@
+--[[
+   @file benchmain.lua
+   @brief   Entry point for the UDP benchmark build (make LUA_MAIN=benchmain).
+   @author  agent <agent@local>
+   Copyright (C) 2026 agent. Distributed under the GNU Lesser General Public License v2.1.
+]]
+
+return require"udpbench".serve(9000)
@@ -0,0 +1,637 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       CoAP server resources (gcoap).
+ *
+ * Two kinds of resources are supported:
+ *
+ * - Lua resources: requests are handed over to the interpreter thread, which
+ *   must be waiting in coap.serve(). The gcoap thread waits for the response
+ *   up to COAP_LUA_TIMEOUT_MS and answers 5.03 if there is none.
+ * - SAUL resources: GET requests are answered entirely in C with the latest
+ *   reading of a device. The reading is cached for max_age milliseconds, so
+ *   repeated requests neither enter the VM nor touch the device. These
+ *   resources can be observed: a low priority thread refreshes them and sends
+ *   a notification when the value changes.
+ *
+ * gcoap has no way of removing resources, so registrations are permanent and
+ * survive interpreter restarts.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+#include "net/gcoap.h"
+#include "saul_reg.h"
+#include "lua_saul.h"
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+#define HANDLERS_TABLE "_coap_handlers"
+
+#ifndef COAP_MAX_RESOURCES
+#define COAP_MAX_RESOURCES (8)
+#endif
+
+#ifndef COAP_PATH_MAX
+#define COAP_PATH_MAX (32)
+#endif
+
+/* Maximum request/response payload for Lua resources. */
+#ifndef COAP_LUA_PAYLOAD_MAX
+#define COAP_LUA_PAYLOAD_MAX (128)
+#endif
+
+#ifndef COAP_LUA_TIMEOUT_MS
+#define COAP_LUA_TIMEOUT_MS (200)
+#endif
+
+/* Period of the check for changes in observed SAUL resources. */
+#ifndef COAP_OBS_PERIOD_MS
+#define COAP_OBS_PERIOD_MS (1000)
+#endif
+
+#ifndef COAP_OBS_PRIO
+#define COAP_OBS_PRIO (THREAD_PRIORITY_MAIN + 1)
+#endif
+
+/* Enough for three values like "-32768000 " or "-3.2768 " */
+#define SAUL_TEXT_MAX (3 * 12)
+
+enum RES_KIND { RES_FREE, RES_LUA, RES_SAUL };
+
+typedef struct {
+    coap_resource_t resource;
+    gcoap_listener_t listener;
+    char path[COAP_PATH_MAX];
+    uint8_t kind;
+    /* SAUL resources */
+    bool observe;
+    bool valid;
+    saul_reg_t *dev;
+    uint32_t max_age;           /**< Cache lifetime in microseconds */
+    uint32_t read_time;
+    char text[SAUL_TEXT_MAX];
+    char notified[SAUL_TEXT_MAX];
+} coap_slot_t;
+
+static coap_slot_t slots[COAP_MAX_RESOURCES];
+static mutex_t slot_lock = MUTEX_INIT;
+
+/* Request being passed to the interpreter */
+static struct {
+    mutex_t lock;
+    mutex_t ready;              /**< Unlocked when there is a request */
+    mutex_t done;               /**< Unlocked when the response is ready */
+    bool waiting;               /**< The gcoap thread waits for a response */
+    coap_slot_t *slot;
+    unsigned method;
+    size_t payload_len;
+    uint8_t payload[COAP_LUA_PAYLOAD_MAX];
+    unsigned code;
+} req = {
+    .lock = MUTEX_INIT,
+    .ready = MUTEX_INIT_LOCKED,
+    .done = MUTEX_INIT_LOCKED,
+};
+
+static struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t lua_calls;
+    uint32_t timeouts;
+    uint32_t notifications;
+} stats;
+
+static kernel_pid_t obs_pid = KERNEL_PID_UNDEF;
+static char obs_stack[THREAD_STACKSIZE_DEFAULT];
+static uint8_t obs_buf[GCOAP_PDU_BUF_SIZE];
+static mutex_t obs_lock = MUTEX_INIT;
+
+/**
+ * Format a phydat as text, e.g. "21.5" or "1 -2 30".
+ */
+static void _phydat2text(const phydat_t *data, int dim, char *out, size_t len)
+{
+    int i, n, z, pos = 0;
+
+    out[0] = '\0';
+
+    for (i = 0; i < dim && (size_t)pos < len; i++) {
+        int val = data->val[i];
+        const char *sep = (i > 0) ? " " : "";
+
+        if (data->scale >= 0) {
+            n = snprintf(out + pos, len - pos, "%s%d", sep, val);
+            for (z = 0; z < data->scale && val != 0 && n > 0
+                        && (size_t)(pos + n) < len - 1; z++) {
+                out[pos + n++] = '0';
+                out[pos + n] = '\0';
+            }
+        } else {
+            int div = 1;
+
+            for (z = 0; z < -data->scale; z++) {
+                div *= 10;
+            }
+            n = snprintf(out + pos, len - pos, "%s%s%d.%0*d", sep,
+                         (val < 0 && val > -div) ? "-" : "", val / div,
+                         -data->scale, (val < 0) ? -(val % div) : val % div);
+        }
+
+        if (n < 0) {
+            break;
+        }
+        pos += n;
+    }
+}
+
+/**
+ * Read a SAUL resource if the cached value is too old.
+ *
+ * Must be called with slot_lock held.
+ */
+static int _refresh(coap_slot_t *s)
+{
+    uint32_t now = xtimer_now_usec();
+    phydat_t data;
+    int dim;
+
+    if (s->valid && now - s->read_time < s->max_age) {
+        stats.hits++;
+        return 0;
+    }
+
+    stats.misses++;
+
+    data.scale = 0;
+    dim = saul_reg_read(s->dev, &data);
+    if (dim <= 0) {
+        s->valid = false;
+        return -1;
+    }
+
+    _phydat2text(&data, dim, s->text, sizeof(s->text));
+    s->read_time = now;
+    s->valid = true;
+
+    return 0;
+}
+
+static ssize_t _reply(coap_pkt_t *pdu, uint8_t *buf, size_t len,
+                      unsigned code, const void *payload, size_t plen)
+{
+    gcoap_resp_init(pdu, buf, len, code);
+
+    if (plen > pdu->payload_len) {
+        plen = pdu->payload_len;
+    }
+    memcpy(pdu->payload, payload, plen);
+
+    return gcoap_finish(pdu, plen, COAP_FORMAT_TEXT);
+}
+
+static ssize_t _saul_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len,
+                             void *ctx)
+{
+    coap_slot_t *s = ctx;
+    char text[SAUL_TEXT_MAX];
+    bool ok;
+
+    mutex_lock(&slot_lock);
+    ok = (_refresh(s) == 0);
+    strcpy(text, s->text);
+    mutex_unlock(&slot_lock);
+
+    if (!ok) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+
+    return _reply(pdu, buf, len, COAP_CODE_CONTENT, text, strlen(text));
+}
+
+static ssize_t _lua_handler(coap_pkt_t *pdu, uint8_t *buf, size_t len,
+                            void *ctx)
+{
+    bool answered;
+    size_t plen = pdu->payload_len;
+
+    if (plen > COAP_LUA_PAYLOAD_MAX) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
+    }
+
+    mutex_lock(&req.lock);
+    /* Discard a response that arrived after a previous timeout */
+    mutex_trylock(&req.done);
+    req.slot = ctx;
+    req.method = coap_get_code_detail(pdu);
+    memcpy(req.payload, pdu->payload, plen);
+    req.payload_len = plen;
+    req.waiting = true;
+    mutex_unlock(&req.lock);
+
+    mutex_unlock(&req.ready);
+    answered = (xtimer_mutex_lock_timeout(&req.done,
+                                          COAP_LUA_TIMEOUT_MS * US_PER_MS) == 0);
+
+    mutex_lock(&req.lock);
+    req.waiting = false;
+    mutex_unlock(&req.lock);
+
+    if (!answered) {
+        stats.timeouts++;
+        return gcoap_response(pdu, buf, len, COAP_CODE_SERVICE_UNAVAILABLE);
+    }
+
+    return _reply(pdu, buf, len, req.code, req.payload, req.payload_len);
+}
+
+static void _notify(coap_slot_t *s, const char *text, size_t len)
+{
+    coap_pkt_t pdu;
+    ssize_t plen;
+
+    mutex_lock(&obs_lock);
+
+    /* Fails if there are no observers */
+    if (gcoap_obs_init(&pdu, obs_buf, sizeof(obs_buf), &s->resource)
+        == GCOAP_OBS_INIT_OK) {
+        if (len > pdu.payload_len) {
+            len = pdu.payload_len;
+        }
+        memcpy(pdu.payload, text, len);
+
+        plen = gcoap_finish(&pdu, len, COAP_FORMAT_TEXT);
+        if (plen > 0 && gcoap_obs_send(obs_buf, plen, &s->resource) > 0) {
+            stats.notifications++;
+        }
+    }
+
+    mutex_unlock(&obs_lock);
+}
+
+static void *_obs_thread(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        unsigned int i;
+
+        xtimer_usleep(COAP_OBS_PERIOD_MS * US_PER_MS);
+
+        for (i = 0; i < COAP_MAX_RESOURCES; i++) {
+            coap_slot_t *s = &slots[i];
+            char text[SAUL_TEXT_MAX];
+            bool changed = false;
+
+            mutex_lock(&slot_lock);
+            if (s->kind == RES_SAUL && s->observe && _refresh(s) == 0
+                && strcmp(s->text, s->notified)) {
+                strcpy(s->notified, s->text);
+                strcpy(text, s->text);
+                changed = true;
+            }
+            mutex_unlock(&slot_lock);
+
+            if (changed) {
+                _notify(s, text, strlen(text));
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Allocate a resource.
+ *
+ * The slot stays free until the caller sets its kind, which must be done
+ * before registering it.
+ */
+static coap_slot_t *_new_slot(lua_State *L, const char *path, unsigned methods,
+                              coap_handler_t handler)
+{
+    unsigned int i;
+    coap_slot_t *s = NULL;
+
+    luaL_argcheck(L, path[0] == '/' && strlen(path) < COAP_PATH_MAX, 1,
+                  "Path must start with '/' and be shorter than COAP_PATH_MAX");
+
+    for (i = 0; i < COAP_MAX_RESOURCES; i++) {
+        if (slots[i].kind == RES_FREE) {
+            s = (s == NULL) ? &slots[i] : s;
+        } else if (!strcmp(slots[i].path, path)) {
+            luaL_error(L, "Path already registered");
+        }
+    }
+
+    if (s == NULL) {
+        luaL_error(L, "Too many resources");
+    }
+
+    strcpy(s->path, path);
+    s->resource.path = s->path;
+    s->resource.methods = methods;
+    s->resource.handler = handler;
+    s->resource.context = s;
+    s->listener.resources = &s->resource;
+    s->listener.resources_len = 1;
+    s->listener.next = NULL;
+
+    return s;
+}
+
+static coap_slot_t *_find_slot(lua_State *L, int arg)
+{
+    const char *path = luaL_checkstring(L, arg);
+    unsigned int i;
+
+    for (i = 0; i < COAP_MAX_RESOURCES; i++) {
+        if (slots[i].kind != RES_FREE && !strcmp(slots[i].path, path)) {
+            return &slots[i];
+        }
+    }
+
+    luaL_argerror(L, arg, "Unknown resource");
+    return NULL;
+}
+
+/**
+ * Register a resource handled by a Lua function.
+ *
+ * The handler is called from coap.serve() as fn(method, payload), where
+ * method is "GET", "POST" or "PUT". It must return the response payload
+ * (string) and optionally a response code as a number (e.g. 205, the default,
+ * or 404). Codes outside 2.00-5.31 are answered with 5.00.
+ *
+ * If the path was registered in a previous interpreter session, the handler
+ * is replaced.
+ *
+ * @param   path    String, e.g. "/led".
+ * @param   fn      Handler function.
+ */
+static int coap_resource(lua_State *L)
+{
+    const char *path = luaL_checkstring(L, 1);
+    unsigned int i;
+    coap_slot_t *s = NULL;
+
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+
+    for (i = 0; i < COAP_MAX_RESOURCES; i++) {
+        if (slots[i].kind == RES_LUA && !strcmp(slots[i].path, path)) {
+            s = &slots[i];
+        }
+    }
+
+    if (s == NULL) {
+        s = _new_slot(L, path, COAP_GET | COAP_POST | COAP_PUT, _lua_handler);
+        s->kind = RES_LUA;
+        gcoap_register_listener(&s->listener);
+    }
+
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, HANDLERS_TABLE);
+    lua_pushvalue(L, 2);
+    lua_rawsetp(L, -2, s);
+
+    return 0;
+}
+
+/**
+ * Register a resource that serves the readings of a SAUL device from C.
+ *
+ * @param   path        String, e.g. "/light".
+ * @param   dev         SAUL device object.
+ * @param   max_age_ms  (optional) How long a reading is reused. Default 0
+ *                      (read the device on each request).
+ * @param   observe     (optional) If true, check the device periodically and
+ *                      notify observers when the value changes.
+ */
+static int coap_saul_resource(lua_State *L)
+{
+    const char *path = luaL_checkstring(L, 1);
+    saul_reg_t *dev = lua_saul_checkdev(L, 2);
+    lua_Integer max_age = luaL_optinteger(L, 3, 0);
+    bool observe = lua_toboolean(L, 4);
+    coap_slot_t *s;
+
+    luaL_argcheck(L, max_age >= 0 && max_age <= UINT32_MAX / US_PER_MS, 3,
+                  "Out of range");
+
+    if (observe && obs_pid == KERNEL_PID_UNDEF) {
+        obs_pid = thread_create(obs_stack, sizeof(obs_stack), COAP_OBS_PRIO,
+                                THREAD_CREATE_STACKTEST, _obs_thread, NULL,
+                                "coap_obs");
+        if (obs_pid < 0) {
+            obs_pid = KERNEL_PID_UNDEF;
+            return luaL_error(L, "Cannot start observe thread");
+        }
+    }
+
+    s = _new_slot(L, path, COAP_GET, _saul_handler);
+    s->dev = dev;
+    s->max_age = max_age * US_PER_MS;
+    s->observe = observe;
+    s->valid = false;
+    s->notified[0] = '\0';
+
+    mutex_lock(&slot_lock);
+    s->kind = RES_SAUL;
+    mutex_unlock(&slot_lock);
+
+    gcoap_register_listener(&s->listener);
+
+    return 0;
+}
+
+/**
+ * Wait for a request to a Lua resource and handle it.
+ *
+ * @param   timeout_ms  (optional) Maximum time to wait. -1 (the default)
+ *                      waits forever.
+ *
+ * @return  true if a request was handled, false on timeout.
+ */
+static int coap_serve(lua_State *L)
+{
+    lua_Integer timeout = luaL_optinteger(L, 1, -1);
+    static const char *const methods[] = {"", "GET", "POST", "PUT", "DELETE"};
+    uint8_t payload[COAP_LUA_PAYLOAD_MAX];
+    size_t payload_len, len;
+    const char *response;
+    lua_Integer code;
+    coap_slot_t *slot;
+    unsigned method;
+    uint32_t start = xtimer_now_usec();
+    bool found;
+
+    /* Before locking, it may raise an error */
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, HANDLERS_TABLE);
+
+    while (1) {
+        if (timeout < 0) {
+            mutex_lock(&req.ready);
+        } else {
+            lua_Integer left = timeout * US_PER_MS
+                               - (lua_Integer)(xtimer_now_usec() - start);
+
+            if (xtimer_mutex_lock_timeout(&req.ready, (left > 0) ? left : 0)) {
+                lua_pushboolean(L, 0);
+                return 1;
+            }
+        }
+
+        mutex_lock(&req.lock);
+        if (req.waiting) {
+            break;
+        }
+        /* Stale wakeup from a request that timed out before anybody served
+         * it, wait for the next one */
+        mutex_unlock(&req.lock);
+    }
+
+    /* Nothing here may raise an error while the lock is held */
+    slot = req.slot;
+    method = req.method;
+    payload_len = req.payload_len;
+    memcpy(payload, req.payload, payload_len);
+    mutex_unlock(&req.lock);
+
+    found = (lua_rawgetp(L, -1, slot) == LUA_TFUNCTION);
+    if (found) {
+        lua_pushstring(L, (method < 5) ? methods[method] : "");
+        lua_pushlstring(L, (const char *)payload, payload_len);
+    }
+
+    if (!found) {
+        /* The resource was removed while the request was queued */
+        response = NULL;
+        code = 404;
+    } else {
+        stats.lua_calls++;
+
+        if (lua_pcall(L, 2, 2, 0) != LUA_OK) {
+            response = lua_tolstring(L, -1, &len);
+            code = 500;
+        } else {
+            int isnum;
+
+            response = lua_tolstring(L, -2, &len);
+            code = lua_tointegerx(L, -1, &isnum);
+            if (!isnum) {
+                code = 205;
+            } else if (code < 200 || code > 599 || code % 100 > 31) {
+                response = "Invalid response code";
+                len = strlen(response);
+                code = 500;
+            }
+        }
+    }
+
+    if (response == NULL) {
+        response = "";
+        len = 0;
+    }
+
+    mutex_lock(&req.lock);
+    if (req.waiting && req.slot == slot) {
+        if (len > COAP_LUA_PAYLOAD_MAX) {
+            len = COAP_LUA_PAYLOAD_MAX;
+        }
+        memcpy(req.payload, response, len);
+        req.payload_len = len;
+        req.code = ((code / 100) << 5) | (code % 100);
+        mutex_unlock(&req.done);
+    }
+    mutex_unlock(&req.lock);
+
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+/**
+ * Send a notification to the observers of a Lua resource.
+ *
+ * @param   path    Path of the resource.
+ * @param   payload String.
+ */
+static int coap_notify(lua_State *L)
+{
+    coap_slot_t *s = _find_slot(L, 1);
+    size_t len;
+    const char *payload = luaL_checklstring(L, 2, &len);
+
+    _notify(s, payload, len);
+
+    return 0;
+}
+
+/**
+ * Get server statistics.
+ *
+ * @return  Table with fields hits and misses (cache of SAUL resources),
+ *          lua_calls, timeouts (requests to Lua resources that were not
+ *          served in time) and notifications.
+ */
+static int coap_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 5);
+
+    lua_pushinteger(L, stats.hits);
+    lua_setfield(L, -2, "hits");
+    lua_pushinteger(L, stats.misses);
+    lua_setfield(L, -2, "misses");
+    lua_pushinteger(L, stats.lua_calls);
+    lua_setfield(L, -2, "lua_calls");
+    lua_pushinteger(L, stats.timeouts);
+    lua_setfield(L, -2, "timeouts");
+    lua_pushinteger(L, stats.notifications);
+    lua_setfield(L, -2, "notifications");
+
+    return 1;
+}
+
+static const luaL_Reg funcs[] = {
+  {"resource", coap_resource},
+  {"saul_resource", coap_saul_resource},
+  {"serve", coap_serve},
+  {"notify", coap_notify},
+  {"stats", coap_stats},
+  {NULL, NULL}
+};
+
+/**
+ * Load the library.
+ *
+ * @return      Lua table.
+ */
+int luaopen_coap(lua_State *L)
+{
+    luaL_newlib(L, funcs);
+
+    return 1;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Garbage collection while the interpreter is idle.
+ *
+ * There is only one interpreter, so the budget and the statistics are global.
+ * The heap size after the last idle cycle belongs to the state and is kept in
+ * its registry.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include "xtimer.h"
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lua_idlegc.h"
+
+/* Heap size after the last cycle completed during idle time */
+#define CLEAN_SIZE_KEY "_idlegc_clean"
+
+static uint32_t idle_budget = LUA_IDLE_GC_BUDGET_US;
+
+static struct {
+    uint32_t calls;
+    uint32_t skipped;
+    uint32_t steps;
+    uint32_t cycles;
+    uint64_t time_us;
+} stats;
+
+static size_t _heap_size(lua_State *L)
+{
+    return (size_t)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+uint32_t lua_idle_gc(lua_State *L, uint32_t max_us)
+{
+    uint32_t start, elapsed;
+    lua_Integer clean_size;
+
+    if (max_us > idle_budget) {
+        max_us = idle_budget;
+    }
+
+    if (max_us == 0) {
+        return 0;
+    }
+
+    stats.calls++;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, CLEAN_SIZE_KEY);
+    clean_size = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+
+    if (!lua_gc(L, LUA_GCISRUNNING, 0) || _heap_size(L) <= (size_t)clean_size) {
+        stats.skipped++;
+        return 0;
+    }
+
+    start = xtimer_now_usec();
+
+    do {
+        stats.steps++;
+        if (lua_gc(L, LUA_GCSTEP, 0)) {
+            stats.cycles++;
+            lua_pushinteger(L, _heap_size(L));
+            lua_setfield(L, LUA_REGISTRYINDEX, CLEAN_SIZE_KEY);
+            break;
+        }
+    } while (xtimer_now_usec() - start < max_us);
+
+    elapsed = xtimer_now_usec() - start;
+    stats.time_us += elapsed;
+
+    return elapsed;
+}
+
+/**
+ * Let the collector use the idle time budget now.
+ *
+ * Call this before blocking in functions that do not do it by themselves
+ * (e.g. io.read).
+ *
+ * @return  Time spent, in microseconds.
+ */
+int lua_riot_idle(lua_State *L)
+{
+    lua_pushinteger(L, lua_idle_gc(L, UINT32_MAX));
+
+    return 1;
+}
+
+/**
+ * Get or set the maximum time spent collecting each time the interpreter goes
+ * idle.
+ *
+ * @param   budget_us   (optional) New budget. 0 disables idle collection.
+ *
+ * @return  Previous budget, in microseconds.
+ */
+int lua_riot_idle_gc(lua_State *L)
+{
+    lua_Integer budget = luaL_optinteger(L, 1, idle_budget);
+
+    luaL_argcheck(L, budget >= 0 && budget <= UINT32_MAX, 1, "Out of range");
+
+    lua_pushinteger(L, idle_budget);
+    idle_budget = budget;
+
+    return 1;
+}
+
+/**
+ * Get the idle collection statistics.
+ *
+ * @return  Table with fields budget_us, calls, skipped (calls where there was
+ *          nothing to collect), steps, cycles (full cycles completed while
+ *          idle) and time_us (total time spent collecting while idle).
+ */
+int lua_riot_gc_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 6);
+
+    lua_pushinteger(L, idle_budget);
+    lua_setfield(L, -2, "budget_us");
+
+    lua_pushinteger(L, stats.calls);
+    lua_setfield(L, -2, "calls");
+
+    lua_pushinteger(L, stats.skipped);
+    lua_setfield(L, -2, "skipped");
+
+    lua_pushinteger(L, stats.steps);
+    lua_setfield(L, -2, "steps");
+
+    lua_pushinteger(L, stats.cycles);
+    lua_setfield(L, -2, "cycles");
+
+    lua_pushinteger(L, stats.time_us);
+    lua_setfield(L, -2, "time_us");
+
+    return 1;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Garbage collection while the interpreter is idle.
+ *
+ * Functions that block the interpreter thread (sleep, socket receive, waiting
+ * for input) first use part of the waiting time to advance the incremental
+ * collector, so that less collection work is left for the code that runs
+ * afterwards.
+ *
+ * @author      agent <agent@local>
+ */
+
+#ifndef LUA_IDLEGC_H
+#define LUA_IDLEGC_H
+
+#include <stdint.h>
+
+#include "lua.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Default maximum time spent collecting each time the interpreter goes idle.
+ */
+#ifndef LUA_IDLE_GC_BUDGET_US
+#define LUA_IDLE_GC_BUDGET_US (2000)
+#endif
+
+/**
+ * Perform incremental GC steps.
+ *
+ * Stops when a collection cycle finishes, or after @p max_us or the configured
+ * budget (whichever is smaller) have elapsed. Nothing is done if the heap did
+ * not grow since the last cycle finished here or if the collector is stopped.
+ *
+ * @param   max_us  Time the caller is going to wait anyways.
+ *
+ * @return  Time spent, in microseconds.
+ */
+uint32_t lua_idle_gc(lua_State *L, uint32_t max_us);
+
+/**
+ * @name    Lua interface (registered in the riot module)
+ * @{
+ */
+int lua_riot_idle(lua_State *L);
+int lua_riot_idle_gc(lua_State *L);
+int lua_riot_gc_stats(lua_State *L);
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUA_IDLEGC_H */
+/** @} */
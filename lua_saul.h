@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Definitions shared by modules that handle SAUL device objects.
+ *
+ * @author      agent <agent@local>
+ */
+
+#ifndef LUA_SAUL_H
+#define LUA_SAUL_H
+
+#include "saul_reg.h"
+
+#include "lua.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Metatable name for SAUL device objects.
+ */
+#define SAULDEV_TNAME "saul_dev"
+
+/**
+ * Metatable name for numeric arrays.
+ */
+#define SAULARRAY_TNAME "saul_array"
+
+/**
+ * Check that argument @p arg is a SAUL device object and get the device.
+ *
+ * Raises a Lua error if the argument has the wrong type.
+ */
+saul_reg_t *lua_saul_checkdev(lua_State *L, int arg);
+
+/**
+ * Convert up to PHYDAT_DIM floating point values into a phydat, choosing the
+ * scale so that the largest value uses the full range.
+ */
+void lua_saul_float2phydat(const float *values, int n, phydat_t *data);
+
+/**
+ * Convert the first @p n values of a phydat into floating point numbers.
+ *
+ * @return  n
+ */
+int lua_saul_phydat2float(const phydat_t *data, int n, float *values);
+
+/**
+ * @name    Numeric arrays (saularray.c)
+ * @{
+ */
+
+/**
+ * Get the contents of a numeric array.
+ *
+ * @param       up      Upvalue of the calling C function that holds the array
+ *                      metatable, or 0 to look it up in the registry (see
+ *                      lua_testudata_up).
+ * @param[out]  len     Number of elements.
+ *
+ * @return  Pointer to the elements, or NULL if the argument is not an array.
+ */
+float *lua_saul_toarray(lua_State *L, int arg, int up, lua_Integer *len);
+
+/**
+ * Create the metatable for numeric arrays and push it on the stack.
+ */
+void lua_saul_openarray(lua_State *L);
+
+int lua_saul_array(lua_State *L);
+/** @} */
+
+/**
+ * @name    Actuator control (actuator.c)
+ * @{
+ */
+int lua_saul_ramp(lua_State *L);
+int lua_saul_write_coalesced(lua_State *L);
+int lua_saul_busy(lua_State *L);
+int lua_saul_actuator_stats(lua_State *L);
+
+/**
+ * Tell the actuator thread that a device was written directly.
+ *
+ * Keeps the value used for skipping redundant writes and as starting point of
+ * ramps in sync with the device.
+ *
+ * @param   data    Value written, or NULL if it is unknown (e.g. the write
+ *                  failed).
+ */
+void lua_saul_actuator_written(saul_reg_t *dev, const phydat_t *data);
+/** @} */
+
+/**
+ * @name    Change notifications (saulevt.c)
+ * @{
+ */
+int lua_saul_on_change(lua_State *L);
+int lua_saul_events(lua_State *L);
+
+/**
+ * Set up change notifications for a new state.
+ *
+ * Stops watching the devices registered by a previous state, and makes sure
+ * that all watchers are stopped when this state is closed.
+ */
+void lua_saul_events_open(lua_State *L);
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUA_SAUL_H */
+/** @} */
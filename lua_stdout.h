@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Buffered output for Lua.
+ *
+ * Replaces print, io.write, io.stdout:write and io.flush with functions that
+ * copy the data to a ring buffer. A low priority thread writes the buffer to
+ * stdout, so that output only goes to the UART when there is nothing else to
+ * do.
+ *
+ * Output generated in C with printf is not buffered. Call lua_stdout_flush()
+ * before such output to keep it in order.
+ *
+ * @author      agent <agent@local>
+ */
+
+#ifndef LUA_STDOUT_H
+#define LUA_STDOUT_H
+
+#include "lua.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Size of the output buffer.
+ */
+#ifndef LUA_STDOUT_BUF_SIZE
+#define LUA_STDOUT_BUF_SIZE (512)
+#endif
+
+/**
+ * Wait until all buffered output has been written.
+ *
+ * Does nothing if the buffer was never enabled.
+ */
+void lua_stdout_flush(void);
+
+/**
+ * @name    Lua interface (registered in the riot module)
+ * @{
+ */
+int lua_riot_stdout_buffer(lua_State *L);
+int lua_riot_flush(lua_State *L);
+int lua_riot_stdout_stats(lua_State *L);
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUA_STDOUT_H */
+/** @} */
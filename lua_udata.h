@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Fast type checks for full userdata.
+ *
+ * luaL_checkudata looks up the metatable in the registry by name on every
+ * call. Methods that are registered with their type's metatable as an upvalue
+ * (see luaL_setfuncs) can instead compare against the upvalue, which needs no
+ * string lookup. The upvalue index is always given explicitly, and functions
+ * exported to other modules should not use the fast path, since they cannot
+ * know the upvalues of their callers.
+ *
+ * Define LUA_UDATA_REGISTRY_CHECK to always use luaL_checkudata (useful for
+ * benchmarking).
+ *
+ * @author      agent <agent@local>
+ */
+
+#ifndef LUA_UDATA_H
+#define LUA_UDATA_H
+
+#include "lua.h"
+#include "lauxlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Test whether argument @p arg is a userdata of type @p tname.
+ *
+ * If @p up is not 0, the metatable of the argument is first compared with
+ * upvalue number @p up of the calling C function. The caller must make sure
+ * that this upvalue, if present, is the metatable of @p tname: otherwise a
+ * userdata of the wrong type would be accepted. If the comparison fails (or
+ * @p up is 0) this falls back to luaL_testudata.
+ *
+ * @return  The userdata, or NULL if the argument has the wrong type.
+ */
+static inline void *lua_testudata_up(lua_State *L, int arg, int up,
+                                     const char *tname)
+{
+#ifndef LUA_UDATA_REGISTRY_CHECK
+    void *p = lua_touserdata(L, arg);
+
+    if (up != 0 && p != NULL && lua_getmetatable(L, arg)) {
+        int same = lua_rawequal(L, -1, lua_upvalueindex(up));
+
+        lua_pop(L, 1);
+        if (same) {
+            return p;
+        }
+    }
+#else
+    (void)up;
+#endif
+
+    return luaL_testudata(L, arg, tname);
+}
+
+/**
+ * Check that argument @p arg is a userdata of type @p tname.
+ *
+ * Like lua_testudata_up, but raises the same error as luaL_checkudata if the
+ * argument has the wrong type. Only for functions private to the module that
+ * registers them with the upvalue.
+ */
+static inline void *lua_checkudata_up(lua_State *L, int arg, int up,
+                                      const char *tname)
+{
+    void *p = lua_testudata_up(L, arg, up, tname);
+
+    return (p != NULL) ? p : luaL_checkudata(L, arg, tname);
+}
+
+/**
+ * Create a table with the functions in @p l, each one having the table at
+ * @p mt_index (a metatable) as first upvalue.
+ *
+ * The new table is pushed on the stack.
+ */
+static inline void lua_newlib_up(lua_State *L, const luaL_Reg *l, int mt_index)
+{
+    mt_index = lua_absindex(L, mt_index);
+    lua_newtable(L);
+    lua_pushvalue(L, mt_index);
+    luaL_setfuncs(L, l, 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUA_UDATA_H */
+/** @} */
@@ -21,16 +21,33 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifdef MODULE_SERVO
 #include "periph/pwm.h"
 #include "servo.h"
+#endif
+#ifdef MODULE_TSL4531X
 #include "tsl4531x.h"
 #include "tsl4531x_saul.h"
+#endif
 #include "saul.h"
 #include "saul_reg.h"
 
 #include "lua_run.h"
 #include "lua_builtin.h"
+#include "lua_stdout.h"
+#ifdef LUA_WARM_START
+#include "checksum/fletcher32.h"
+#include "lauxlib.h"
+#endif
 #include "repl.lua.h"
+#ifdef SAUL_FARM_N
+#include "saulbench.lua.h"
+#include "udatabench.lua.h"
+#endif
+#ifdef LUA_UDP_BENCH
+#include "benchmain.lua.h"
+#include "udpbench.lua.h"
+#endif
 
 /* The basic interpreter+repl needs about 13k ram AT Minimum but we need more
  * memory in order to do interesting stuff.
@@ -41,27 +58,225 @@ static char lua_memory[MAIN_LUA_MEM_SIZE] __attribute__ ((aligned(__BIGGEST_ALIG
 
 #define BARE_MINIMUM_MODS (LUAR_LOAD_BASE | LUAR_LOAD_IO | LUAR_LOAD_PACKAGE | LUAR_LOAD_MATH)
 
+/* The benchmark scripts also need string and table */
+#define LUA_MODS (BARE_MINIMUM_MODS | LUAR_LOAD_STRING | LUAR_LOAD_TABLE)
+
+/* Module run by the main loop. Select another with "make LUA_MAIN=<module>" */
+#ifndef LUA_MAIN_MODULE
+#define LUA_MAIN_MODULE "repl"
+#endif
+
+/* The benchmarks are only built with the options that use them (SAUL_FARM
+ * and LUA_MAIN=benchmain). This table must stay sorted. */
 const struct lua_riot_builtin_lua _lua_riot_builtin_lua_table[] = {
-    { "repl", repl_lua, sizeof(repl_lua) }
+#ifdef LUA_UDP_BENCH
+    { "benchmain", benchmain_lua, sizeof(benchmain_lua) },
+#endif
+    { "repl", repl_lua, sizeof(repl_lua) },
+#ifdef SAUL_FARM_N
+    { "saulbench", saulbench_lua, sizeof(saulbench_lua) },
+    { "udatabench", udatabench_lua, sizeof(udatabench_lua) },
+#endif
+#ifdef LUA_UDP_BENCH
+    { "udpbench", udpbench_lua, sizeof(udpbench_lua) },
+#endif
 };
 
+extern int luaopen_coap(lua_State *L);
 extern int luaopen_socket(lua_State *L);
 extern int luaopen_riot(lua_State *L);
 extern int luaopen_saul(lua_State *L);
+#ifdef LUA_TSLOG
+extern int luaopen_tslog(lua_State *L);
+#endif
 
 const struct lua_riot_builtin_c _lua_riot_builtin_c_table[] = {
+    { "coap", luaopen_coap},
     { "riot", luaopen_riot},
     { "saul", luaopen_saul},
-    { "socket", luaopen_socket}
+    { "socket", luaopen_socket},
+#ifdef LUA_TSLOG
+    { "tslog", luaopen_tslog},
+#endif
 };
 
 const struct lua_riot_builtin_lua *const lua_riot_builtin_lua_table = _lua_riot_builtin_lua_table;
 const struct lua_riot_builtin_c *const lua_riot_builtin_c_table = _lua_riot_builtin_c_table;
 
-const size_t lua_riot_builtin_lua_table_len = 1;
-const size_t lua_riot_builtin_c_table_len = 3;
+const size_t lua_riot_builtin_lua_table_len =
+    sizeof(_lua_riot_builtin_lua_table) / sizeof(_lua_riot_builtin_lua_table[0]);
+const size_t lua_riot_builtin_c_table_len =
+    sizeof(_lua_riot_builtin_c_table) / sizeof(_lua_riot_builtin_c_table[0]);
+
+#ifdef SAUL_FARM_N
+extern int saul_farm_init(void);
+#endif
+
+#ifdef LUA_WARM_START
+/* The snapshot of the Lua heap is ordinary static data, so it survives
+ * restarts of the REPL but not resets. If LUA_SNAPSHOT_SECTION names a RAM
+ * section that the board's linker script defines as NOLOAD and the startup
+ * code does not clear (see LUA_WARM_START_NOINIT_BOARDS in the Makefile), it
+ * also survives soft resets. */
+#ifdef LUA_SNAPSHOT_SECTION
+#define LUA_SNAPSHOT_ATTR __attribute__ ((section(LUA_SNAPSHOT_SECTION)))
+#else
+#define LUA_SNAPSHOT_ATTR
+#endif
+
+#define LUA_SNAPSHOT_MAGIC (0x4c534e50) /* "LSNP" */
+
+/* Start and end of the code and read-only data of the firmware, as defined by
+ * the linker script. */
+#ifndef LUA_IMAGE_START
+#ifdef CPU_NATIVE
+#define LUA_IMAGE_START __executable_start
+#define LUA_IMAGE_END   etext
+#else
+#define LUA_IMAGE_START _sfixed
+#define LUA_IMAGE_END   _etext
+#endif
+#endif
+
+extern const char LUA_IMAGE_START[];
+extern const char LUA_IMAGE_END[];
+
+struct lua_snapshot {
+    uint32_t magic;
+    uint32_t build;
+    uint32_t size;
+    uint32_t checksum;
+    lua_State *L;
+    char image[MAIN_LUA_MEM_SIZE] __attribute__ ((aligned(__BIGGEST_ALIGNMENT__)));
+};
+
+static struct lua_snapshot lua_snapshot LUA_SNAPSHOT_ATTR;
+
+/**
+ * Identify the firmware build.
+ *
+ * A snapshot contains pointers to code and static data, so it can only be
+ * restored by the same binary. The identifier is a checksum of the whole code
+ * and read-only data, computed once.
+ */
+static uint32_t _build_id(void)
+{
+    static uint32_t id;
+
+    if (id == 0) {
+        size_t len = (size_t)(LUA_IMAGE_END - LUA_IMAGE_START);
+
+        id = fletcher32((const uint16_t *)LUA_IMAGE_START,
+                        len / sizeof(uint16_t));
+        id ^= len;
+    }
+
+    return id;
+}
 
+static uint32_t _snapshot_checksum(void)
+{
+    return fletcher32((const uint16_t *)lua_snapshot.image,
+                      sizeof(lua_snapshot.image) / sizeof(uint16_t));
+}
+
+static void _snapshot_save(lua_State *L)
+{
+    memcpy(lua_snapshot.image, lua_memory, MAIN_LUA_MEM_SIZE);
+    lua_snapshot.L = L;
+    lua_snapshot.size = MAIN_LUA_MEM_SIZE;
+    lua_snapshot.build = _build_id();
+    lua_snapshot.checksum = _snapshot_checksum();
+    lua_snapshot.magic = LUA_SNAPSHOT_MAGIC;
+}
 
+/**
+ * Restore the Lua heap from the snapshot.
+ *
+ * @return  The Lua state, or NULL if there is no valid snapshot.
+ */
+static lua_State *_snapshot_restore(void)
+{
+    if (lua_snapshot.magic != LUA_SNAPSHOT_MAGIC
+        || lua_snapshot.build != _build_id()
+        || lua_snapshot.size != MAIN_LUA_MEM_SIZE
+        || lua_snapshot.checksum != _snapshot_checksum()) {
+        return NULL;
+    }
+
+    memcpy(lua_memory, lua_snapshot.image, MAIN_LUA_MEM_SIZE);
+
+    return lua_snapshot.L;
+}
+
+static int _panic(lua_State *L)
+{
+    printf("Lua panic: %s\n", lua_tostring(L, -1));
+
+    return 0;
+}
+
+static int _preload(lua_State *L)
+{
+    size_t i;
+
+    lua_riot_openlibs(L, LUA_MODS);
+
+    for (i = 0; i < lua_riot_builtin_c_table_len; i++) {
+        luaL_requiref(L, lua_riot_builtin_c_table[i].name,
+                      lua_riot_builtin_c_table[i].luaopen, 0);
+        lua_pop(L, 1);
+    }
+
+    return 0;
+}
+
+static const struct lua_riot_builtin_lua *_find_main(void)
+{
+    size_t i;
+
+    for (i = 0; i < lua_riot_builtin_lua_table_len; i++) {
+        if (!strcmp(lua_riot_builtin_lua_table[i].name, LUA_MAIN_MODULE)) {
+            return &lua_riot_builtin_lua_table[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Create the interpreter, load the libraries and modules and compile the
+ * main module. The compiled module is left on the stack.
+ */
+static lua_State *_setup_state(void)
+{
+    const struct lua_riot_builtin_lua *main_mod = _find_main();
+    lua_State *L;
+
+    if (main_mod == NULL) {
+        puts("Main module not found");
+        return NULL;
+    }
+
+    L = lua_riot_newstate(lua_memory, MAIN_LUA_MEM_SIZE, _panic);
+    if (L == NULL) {
+        return NULL;
+    }
+
+    lua_pushcfunction(L, _preload);
+    if (lua_pcall(L, 0, 0, 0) != LUA_OK
+        || luaL_loadbuffer(L, (const char *)main_mod->code,
+                           main_mod->code_size, main_mod->name) != LUA_OK) {
+        printf("Error setting up Lua: %s\n", lua_tostring(L, -1));
+        lua_riot_close(L);
+        return NULL;
+    }
+
+    return L;
+}
+#endif /* LUA_WARM_START */
+
+#ifdef MODULE_SERVO
 static int write_servo(const void *dev, phydat_t *res)
 {
     servo_set(dev, res->val[0]);
@@ -73,16 +288,18 @@ const saul_driver_t servo_saul_driver = {
     .write = write_servo,
     .type = SAUL_ACT_SERVO
 };
+#endif
 
 int main(void)
 {
+#if defined(MODULE_SERVO) || defined(MODULE_TSL4531X)
     int res;
+#endif
+
+#ifdef MODULE_SERVO
     servo_t servo;
-    tsl4531x_t lux_sensor;
     saul_reg_t servo_reg = {.dev = &servo, .name = "Servomotor",
-                            .driver=&servo_saul_driver},
-               lux_reg = {.dev = &lux_sensor, .name = "TSL45315",
-                          .driver = &tsl4531x_saul_driver};
+                            .driver=&servo_saul_driver};
 
     res = servo_init(&servo, PWM_DEV(0), 0, 1000, 2000);
     if (res < 0) {
@@ -96,6 +313,12 @@ int main(void)
         return -1;
     }
     puts("Servo registered.");
+#endif
+
+#ifdef MODULE_TSL4531X
+    tsl4531x_t lux_sensor;
+    saul_reg_t lux_reg = {.dev = &lux_sensor, .name = "TSL45315",
+                          .driver = &tsl4531x_saul_driver};
 
     res = tsl4531x_init(&lux_sensor, TSL4531_I2C_PORT, TSL4531x_INTEGRATE_100ms);
     if (res < 0) {
@@ -109,17 +332,59 @@ int main(void)
         return -1;
     }
     puts("Light sensor registered.");
+#endif
+
+#ifdef SAUL_FARM_N
+    if (saul_farm_init() < 0) {
+        puts("Failed to register synthetic devices");
+        return -1;
+    }
+    printf("Registered %d synthetic devices.\n", SAUL_FARM_N);
+#endif
 
     printf("Using memory range for Lua heap: %p - %p, %zu bytes\n",
            lua_memory, lua_memory + MAIN_LUA_MEM_SIZE, sizeof(void *));
 
     while (1) {
         int status, value;
+#ifdef LUA_WARM_START
+        lua_State *L = _snapshot_restore();
+
+        if (L != NULL) {
+            puts("Restored Lua heap snapshot.");
+        } else if ((L = _setup_state()) != NULL) {
+            _snapshot_save(L);
+            puts("Saved Lua heap snapshot.");
+        } else {
+            return -1;
+        }
+#endif
         puts("This is Lua: starting interactive session\n");
 
-        status = lua_riot_do_module("repl", lua_memory, MAIN_LUA_MEM_SIZE,
-                                    BARE_MINIMUM_MODS, &value);
+#ifdef LUA_WARM_START
+        switch (lua_pcall(L, 0, 1, 0)) {
+            case LUA_OK:
+                status = LUAR_EXIT;
+                value = lua_tointeger(L, -1);
+                break;
+            case LUA_ERRMEM:
+                status = LUAR_MEMORY_ERR;
+                value = 0;
+                break;
+            default:
+                lua_stdout_flush();
+                printf("%s\n", lua_tostring(L, -1));
+                status = LUAR_RUNTIME_ERR;
+                value = 0;
+                break;
+        }
+        lua_riot_close(L);
+#else
+        status = lua_riot_do_module(LUA_MAIN_MODULE, lua_memory,
+                                    MAIN_LUA_MEM_SIZE, LUA_MODS, &value);
+#endif
 
+        lua_stdout_flush();
         printf("Exited. status: %s, return code %d\n", lua_riot_strerror(status),
                value);
     }
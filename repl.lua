@@ -5,6 +5,11 @@
    Copyright (C) 2018 Freie Universität Berlin. Distributed under the GNU Lesser General Public License v2.1.
 ]]
 
+local riot = require"riot"
+
+-- Do not wait for the UART on every write. io.flush() still waits.
+riot.stdout_buffer("block")
+
 local function lvlprint(lvl, ...)
     io.write(string.rep(" ", lvl*3))
     io.write(...)
@@ -46,6 +51,8 @@ local _R_ERROR = 3
 local function re()
     io.write("L> ")
     io.flush()
+    -- Collect garbage now instead of during the next command.
+    riot.idle()
     local ln = io.read()
 
     if not ln then
@@ -70,6 +77,7 @@ local function re()
                     else
                         io.write("L.. ")
                         io.flush()
+                        riot.idle()
                         l = io.read()
                     end
                     if #l ~= 0 then
@@ -95,7 +103,15 @@ local function repl()
         local action, fn_or_message = re()
 
         if action == _R_EVAL then
-            local success, msg_or_ret = pcall(fn_or_message)
+            local success, msg_or_ret
+            -- Set repl_budget_us to abort commands that run for too long.
+            if repl_budget_us then
+                success, msg_or_ret = require"riot".run_bounded(fn_or_message,
+                                                nil, repl_budget_us, "abort",
+                                                "repl")
+            else
+                success, msg_or_ret = pcall(fn_or_message)
+            end
             if not success then
                 print("Runtime error", msg_or_ret)
             elseif msg_or_ret ~= nil then
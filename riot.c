@@ -28,6 +28,40 @@
 #include "lua.h"
 #include "lauxlib.h"
 #include "lualib.h"
+#include "lua_idlegc.h"
+#include "lua_stdout.h"
+
+#define JOBSTATS_TABLE "_jobstats"
+
+/* Number of VM instructions between budget checks. */
+#ifndef RUN_BOUNDED_GRANULARITY
+#define RUN_BOUNDED_GRANULARITY (100)
+#endif
+
+#define BUDGET_MSG "budget exceeded"
+
+#define COROUTINE_HOOKED "_bounded_co"
+
+/**
+ * Execution budget of a job.
+ */
+struct budget {
+    lua_Integer max_instructions;   /**< 0 means unlimited */
+    lua_Integer instructions;
+    uint32_t max_us;                /**< 0 means unlimited */
+    uint32_t start;
+    lua_State *co;                  /**< Coroutine running the job */
+    int step;
+    int yield;
+    int exceeded;
+};
+
+/**
+ * Budget of the innermost run_bounded call in progress, or NULL.
+ *
+ * The job and all the coroutines it creates share this budget.
+ */
+static struct budget *active_budget;
 
 /**
  * Run a shell command.
@@ -36,6 +70,9 @@
  * The first string is the name of the command and the rest are the command line
  * arguments.
  *
+ * The command output is not buffered (see stdout_buffer), so the buffer is
+ * flushed first.
+ *
  * @return    Exit status, or nil if the command was not found.
  */
 int _shell(lua_State *L)
@@ -52,6 +89,7 @@ int _shell(lua_State *L)
         argv[i] = luaL_checklstring (L, i+1, NULL);
     }
 
+    lua_stdout_flush();
     retval = shell_call(argc, (char **)argv);
 
     if (retval == -1) {
@@ -65,21 +103,369 @@ int _shell(lua_State *L)
 
 /**
  * Sleep for a (maybe fractional) number of seconds.
+ *
+ * The beginning of the sleep time is used for garbage collection (see
+ * idle_gc).
  */
 int _sleep(lua_State *L)
 {
     lua_Number s = luaL_checknumber(L, 1);
 
     if (s > 0) {
-        xtimer_usleep(s * (1000*1000));
+        uint32_t us = s * (1000*1000);
+        uint32_t spent = lua_idle_gc(L, us);
+
+        if (spent < us) {
+            xtimer_usleep(us - spent);
+        }
     }
 
     return 0;
 }
 
+/**
+ * Get the time since boot in microseconds.
+ *
+ * Useful for measuring time intervals.
+ */
+int _now_us(lua_State *L)
+{
+    lua_pushinteger(L, xtimer_now_usec64());
+
+    return 1;
+}
+
+static void _budget_hook(lua_State *L, lua_Debug *ar)
+{
+    struct budget *b = active_budget;
+
+    (void)ar;
+
+    if (b == NULL) {
+        /* Coroutine created by a job that has already returned */
+        lua_sethook(L, NULL, 0, 0);
+        return;
+    }
+
+    b->instructions += lua_gethookcount(L);
+
+    if (b->exceeded
+        || (b->max_instructions && b->instructions >= b->max_instructions)
+        || (b->max_us && xtimer_now_usec() - b->start >= b->max_us)) {
+        b->exceeded = 1;
+
+        if (b->yield && L == b->co && lua_isyieldable(L)) {
+            lua_yield(L, 0);
+        } else {
+            /* Raise the error again on every instruction, so that the job
+             * cannot keep running by catching it with pcall. */
+            lua_sethook(L, _budget_hook, LUA_MASKCOUNT, 1);
+            luaL_error(L, BUDGET_MSG);
+        }
+    } else if (lua_gethookcount(L) != b->step) {
+        /* Hook left by a previous job */
+        lua_sethook(L, _budget_hook, LUA_MASKCOUNT, b->step);
+    }
+}
+
+/* Put the budget hook on a coroutine created while a job is running. */
+static void _hook_thread(lua_State *co)
+{
+    if (active_budget != NULL) {
+        lua_sethook(co, _budget_hook, LUA_MASKCOUNT, active_budget->step);
+    }
+}
+
+/* Replacement for coroutine.create(). Upvalue 1 is the original. */
+static int _co_create(lua_State *L)
+{
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_insert(L, 1);
+    lua_call(L, lua_gettop(L) - 1, 1);
+    _hook_thread(lua_tothread(L, -1));
+
+    return 1;
+}
+
+/* Function returned by coroutine.wrap(). Upvalue 1 is the coroutine. */
+static int _co_auxwrap(lua_State *L)
+{
+    lua_State *co = lua_tothread(L, lua_upvalueindex(1));
+    int narg = lua_gettop(L);
+    int status, nres;
+
+    if (!lua_checkstack(co, narg)) {
+        return luaL_error(L, "too many arguments to resume");
+    }
+    if (lua_status(co) == LUA_OK && lua_gettop(co) == 0) {
+        return luaL_error(L, "cannot resume dead coroutine");
+    }
+
+    lua_xmove(L, co, narg);
+    status = lua_resume(co, L, narg);
+
+    if (status == LUA_OK || status == LUA_YIELD) {
+        nres = lua_gettop(co);
+        if (!lua_checkstack(L, nres + 1)) {
+            return luaL_error(L, "too many results to resume");
+        }
+        lua_xmove(co, L, nres);
+        return nres;
+    }
+
+    lua_xmove(co, L, 1);
+    if (lua_type(L, -1) == LUA_TSTRING) {
+        luaL_where(L, 1);
+        lua_insert(L, -2);
+        lua_concat(L, 2);
+    }
+
+    return lua_error(L);
+}
+
+/* Replacement for coroutine.wrap(). Upvalue 1 is the original create. */
+static int _co_wrap(lua_State *L)
+{
+    _co_create(L);
+    lua_pushcclosure(L, _co_auxwrap, 1);
+
+    return 1;
+}
+
+/**
+ * Replace coroutine.create and coroutine.wrap by versions that hook the new
+ * coroutines while a job is running. Done only once per state.
+ */
+static void _hook_coroutine_lib(lua_State *L)
+{
+    int top = lua_gettop(L);
+
+    if (lua_getfield(L, LUA_REGISTRYINDEX, COROUTINE_HOOKED) == LUA_TNIL
+        && lua_getglobal(L, "coroutine") == LUA_TTABLE
+        && lua_getfield(L, -1, "create") == LUA_TFUNCTION) {
+        lua_pushvalue(L, -1);
+        lua_pushcclosure(L, _co_create, 1);
+        lua_setfield(L, -3, "create");
+        lua_pushcclosure(L, _co_wrap, 1);
+        lua_setfield(L, -2, "wrap");
+
+        lua_pushboolean(L, 1);
+        lua_setfield(L, LUA_REGISTRYINDEX, COROUTINE_HOOKED);
+    }
+
+    lua_settop(L, top);
+}
+
+/**
+ * Update the execution statistics of a named job.
+ */
+static void _record_stats(lua_State *L, const char *name, uint32_t elapsed,
+                          int exceeded)
+{
+    lua_Integer v;
+
+    if (lua_getfield(L, LUA_REGISTRYINDEX, JOBSTATS_TABLE) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, JOBSTATS_TABLE);
+    }
+
+    if (lua_getfield(L, -1, name) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, 5);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -3, name);
+    }
+
+    lua_getfield(L, -1, "runs");
+    lua_pushinteger(L, lua_tointeger(L, -1) + 1);
+    lua_setfield(L, -3, "runs");
+
+    lua_getfield(L, -2, "exceeded");
+    lua_pushinteger(L, lua_tointeger(L, -1) + (exceeded != 0));
+    lua_setfield(L, -4, "exceeded");
+
+    lua_getfield(L, -3, "total_us");
+    lua_pushinteger(L, lua_tointeger(L, -1) + elapsed);
+    lua_setfield(L, -5, "total_us");
+
+    lua_getfield(L, -4, "wcet_us");
+    v = lua_tointeger(L, -1);
+    lua_pushinteger(L, (elapsed > v) ? elapsed : v);
+    lua_setfield(L, -6, "wcet_us");
+
+    lua_pushinteger(L, elapsed);
+    lua_setfield(L, -6, "last_us");
+
+    lua_pop(L, 6);
+}
+
+/**
+ * Run a function with an execution budget.
+ *
+ * The function is run in a new coroutine with a count hook that checks the
+ * number of VM instructions executed and the elapsed time. The budget is
+ * checked every RUN_BOUNDED_GRANULARITY instructions, so time spent inside a
+ * single C function (e.g. sleep) cannot be interrupted. In "yield" mode, if
+ * the job cannot yield at the point where the budget runs out (e.g. inside a
+ * metamethod called from C) it is aborted instead.
+ *
+ * Coroutines created by the job with coroutine.create or coroutine.wrap share
+ * its budget. When they exceed it they are always aborted, because only the
+ * job itself can be suspended. Once the budget is exceeded in "abort" mode the
+ * error is raised again on every instruction, so catching it with pcall only
+ * lets the handler run until its next instruction.
+ *
+ * Limitations: coroutines created with a reference to the original
+ * coroutine.create saved before the first call to run_bounded, and coroutines
+ * created from C, are not bounded. A job can still catch the error in "abort"
+ * mode and return from pcall into C code (e.g. a __gc metamethod or a function
+ * from another library) that does not execute Lua instructions.
+ *
+ * @param   job         Function (called without arguments) or a coroutine
+ *                      returned by a previous call, to continue running it
+ *                      with a fresh budget.
+ * @param   max_instr   (optional) Maximum number of VM instructions.
+ *                      0 or nil means unlimited.
+ * @param   max_us      (optional) Maximum time in microseconds.
+ *                      0 or nil means unlimited.
+ * @param   mode        (optional) What to do when the budget is exceeded:
+ *                      "abort" (default) or "yield".
+ * @param   name        (optional) Record the execution times under this name
+ *                      (see job_stats).
+ *
+ * @return  true followed by the function results if the job completed.
+ * @return  false, "budget exceeded" if the job was aborted.
+ * @return  false, "budget exceeded", coroutine if the job was suspended.
+ * @return  false, "yielded", coroutine if the job yielded by itself.
+ * @return  false, message on error.
+ */
+int _run_bounded(lua_State *L)
+{
+    static const char *const modes[] = {"abort", "yield", NULL};
+    lua_Integer max_instr = luaL_optinteger(L, 2, 0);
+    lua_Integer max_us = luaL_optinteger(L, 3, 0);
+    int mode = luaL_checkoption(L, 4, "abort", modes);
+    const char *name = luaL_optstring(L, 5, NULL);
+    struct budget b, *outer;
+    lua_State *co;
+    int status, nres, co_index;
+    uint32_t elapsed;
+
+    luaL_argcheck(L, max_instr >= 0, 2, "Must not be negative");
+    luaL_argcheck(L, max_us >= 0 && max_us <= UINT32_MAX, 3, "Out of range");
+    lua_settop(L, 5);
+    _hook_coroutine_lib(L);
+
+    if (lua_type(L, 1) == LUA_TTHREAD) {
+        co = lua_tothread(L, 1);
+        luaL_argcheck(L, lua_status(co) == LUA_YIELD, 1, "Job cannot be resumed");
+        co_index = 1;
+    } else {
+        luaL_checktype(L, 1, LUA_TFUNCTION);
+        co = lua_newthread(L);
+        co_index = lua_gettop(L);
+        lua_pushvalue(L, 1);
+        lua_xmove(L, co, 1);
+    }
+
+    b.max_instructions = max_instr;
+    b.instructions = 0;
+    b.max_us = max_us;
+    b.step = (max_instr && max_instr < RUN_BOUNDED_GRANULARITY) ?
+             max_instr : RUN_BOUNDED_GRANULARITY;
+    b.yield = mode;
+    b.exceeded = 0;
+    b.co = co;
+
+    outer = active_budget;
+    active_budget = &b;
+    lua_sethook(co, _budget_hook, LUA_MASKCOUNT, b.step);
+
+    b.start = xtimer_now_usec();
+    status = lua_resume(co, L, 0);
+    elapsed = xtimer_now_usec() - b.start;
+
+    /* The budget is only valid during this call. Coroutines left behind by
+     * the job are charged to the outer job, if any. */
+    lua_sethook(co, NULL, 0, 0);
+    active_budget = outer;
+
+    if (name != NULL) {
+        _record_stats(L, name, elapsed, b.exceeded);
+    }
+
+    switch (status) {
+        case LUA_OK:
+            nres = lua_gettop(co);
+            if (!lua_checkstack(L, nres + 1)) {
+                return luaL_error(L, "too many results");
+            }
+            lua_pushboolean(L, 1);
+            lua_xmove(co, L, nres);
+            return nres + 1;
+        case LUA_YIELD:
+            lua_settop(co, 0);
+            lua_pushboolean(L, 0);
+            if (b.exceeded) {
+                lua_pushliteral(L, BUDGET_MSG);
+            } else {
+                lua_pushliteral(L, "yielded");
+            }
+            lua_pushvalue(L, co_index);
+            return 3;
+        default:
+            lua_pushboolean(L, 0);
+            if (b.exceeded) {
+                lua_pushliteral(L, BUDGET_MSG);
+            } else {
+                lua_xmove(co, L, 1);
+            }
+            return 2;
+    }
+}
+
+/**
+ * Get the execution statistics of jobs run with run_bounded.
+ *
+ * @param   name    (optional) Job name.
+ *
+ * @return  If name is given, a table with fields runs, exceeded, last_us,
+ *          total_us and wcet_us (worst case execution time of a single call).
+ *          Otherwise, a table with the statistics for all jobs, indexed by
+ *          name.
+ */
+int _job_stats(lua_State *L)
+{
+    const char *name = luaL_optstring(L, 1, NULL);
+
+    if (lua_getfield(L, LUA_REGISTRYINDEX, JOBSTATS_TABLE) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, JOBSTATS_TABLE);
+    }
+
+    if (name != NULL) {
+        lua_getfield(L, -1, name);
+    }
+
+    return 1;
+}
+
 static const luaL_Reg funcs[] = {
   {"shell", _shell},
   {"sleep", _sleep},
+  {"now_us", _now_us},
+  {"run_bounded", _run_bounded},
+  {"job_stats", _job_stats},
+  {"idle", lua_riot_idle},
+  {"idle_gc", lua_riot_idle_gc},
+  {"gc_stats", lua_riot_gc_stats},
+  {"stdout_buffer", lua_riot_stdout_buffer},
+  {"flush", lua_riot_flush},
+  {"stdout_stats", lua_riot_stdout_stats},
   /* placeholders */
   {"BOARD", NULL},
   {"MCU", NULL},
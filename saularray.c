@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Fixed size numeric arrays for sensor data.
+ *
+ * Values are stored contiguously as floats, so that SAUL reads can be stored
+ * without allocating and statistics can be computed in C. Arrays are indexed
+ * from 1 like tables, but the length is fixed at creation.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lua_udata.h"
+#include "lua_saul.h"
+
+typedef struct {
+    lua_Integer len;
+    float data[];
+} saul_array_t;
+
+float *lua_saul_toarray(lua_State *L, int arg, int up, lua_Integer *len)
+{
+    saul_array_t *a = lua_testudata_up(L, arg, up, SAULARRAY_TNAME);
+
+    if (a == NULL) {
+        return NULL;
+    }
+
+    *len = a->len;
+
+    return a->data;
+}
+
+/**
+ * Create a numeric array.
+ *
+ * Must be registered with the array metatable as second upvalue.
+ *
+ * @param   n   Number of elements. All elements are initialized to 0.
+ *
+ * @return  New array.
+ */
+int lua_saul_array(lua_State *L)
+{
+    lua_Integer n = luaL_checkinteger(L, 1);
+    saul_array_t *a;
+    lua_Integer i;
+
+    luaL_argcheck(L, n >= 0
+                  && (size_t)n < (SIZE_MAX - sizeof(*a)) / sizeof(float),
+                  1, "Invalid size");
+
+    a = lua_newuserdata(L, sizeof(*a) + n * sizeof(float));
+    a->len = n;
+    for (i = 0; i < n; i++) {
+        a->data[i] = 0;
+    }
+
+#ifndef LUA_UDATA_REGISTRY_CHECK
+    lua_pushvalue(L, lua_upvalueindex(2));
+    lua_setmetatable(L, -2);
+#else
+    luaL_setmetatable(L, SAULARRAY_TNAME);
+#endif
+
+    return 1;
+}
+
+/**
+ * Parse the optional (first, last, stride) arguments starting at @p arg.
+ *
+ * @return  Number of elements in the range.
+ */
+static lua_Integer _range(lua_State *L, saul_array_t *a, int arg,
+                          lua_Integer *first, lua_Integer *stride)
+{
+    lua_Integer last;
+
+    *first = luaL_optinteger(L, arg, 1);
+    last = luaL_optinteger(L, arg + 1, a->len);
+    *stride = luaL_optinteger(L, arg + 2, 1);
+
+    luaL_argcheck(L, *first >= 1, arg, "Out of range");
+    luaL_argcheck(L, last <= a->len, arg + 1, "Out of range");
+    luaL_argcheck(L, *stride >= 1, arg + 2, "Must be positive");
+
+    if (last < *first) {
+        return 0;
+    }
+
+    *first -= 1;
+
+    return (last - 1 - *first) / *stride + 1;
+}
+
+/**
+ * Compute statistics over the array or part of it.
+ *
+ * Use the stride to select one axis of interleaved multi-axis readings (e.g.
+ * a stride of 3 for x,y,z data).
+ *
+ * @param   first   (optional) Index of the first element. Default 1.
+ * @param   last    (optional) Index of the last element. Default #a.
+ * @param   stride  (optional) Distance between elements. Default 1.
+ *
+ * @return  min, max, mean and standard deviation, or nothing if the range is
+ *          empty.
+ */
+static int array_stats(lua_State *L)
+{
+    saul_array_t *a = lua_checkudata_up(L, 1, 1, SAULARRAY_TNAME);
+    lua_Integer first, stride, i, n;
+    float min, max;
+    double mean = 0, m2 = 0;
+
+    n = _range(L, a, 2, &first, &stride);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    min = max = a->data[first];
+
+    /* Welford's algorithm */
+    for (i = 0; i < n; i++) {
+        float x = a->data[first + i * stride];
+        double delta = x - mean;
+
+        min = fminf(min, x);
+        max = fmaxf(max, x);
+
+        mean += delta / (i + 1);
+        m2 += delta * (x - mean);
+    }
+
+    lua_pushnumber(L, min);
+    lua_pushnumber(L, max);
+    lua_pushnumber(L, mean);
+    lua_pushnumber(L, sqrt(m2 / n));
+
+    return 4;
+}
+
+/**
+ * Apply an exponential moving average filter over the array or part of it.
+ *
+ * The array is not modified.
+ *
+ * @param   alpha   Smoothing factor, between 0 and 1.
+ * @param   first   (optional) Index of the first element. Default 1.
+ * @param   last    (optional) Index of the last element. Default #a.
+ * @param   stride  (optional) Distance between elements. Default 1.
+ *
+ * @return  Filter output after the last element, or nothing if the range is
+ *          empty.
+ */
+static int array_ema(lua_State *L)
+{
+    saul_array_t *a = lua_checkudata_up(L, 1, 1, SAULARRAY_TNAME);
+    float alpha = luaL_checknumber(L, 2);
+    lua_Integer first, stride, i, n;
+    float y;
+
+    luaL_argcheck(L, alpha >= 0 && alpha <= 1, 2, "Out of range");
+
+    n = _range(L, a, 3, &first, &stride);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    y = a->data[first];
+
+    for (i = 1; i < n; i++) {
+        y += alpha * (a->data[first + i * stride] - y);
+    }
+
+    lua_pushnumber(L, y);
+
+    return 1;
+}
+
+/**
+ * Set all elements to the same value.
+ *
+ * @param   value   (optional) Default 0.
+ */
+static int array_fill(lua_State *L)
+{
+    saul_array_t *a = lua_checkudata_up(L, 1, 1, SAULARRAY_TNAME);
+    float value = luaL_optnumber(L, 2, 0);
+    lua_Integer i;
+
+    for (i = 0; i < a->len; i++) {
+        a->data[i] = value;
+    }
+
+    return 0;
+}
+
+/**
+ * __index metamethod.
+ *
+ * Integer keys return elements (nil if out of range), other keys are looked up
+ * in the methods table (second upvalue).
+ */
+static int array_index(lua_State *L)
+{
+    saul_array_t *a = lua_checkudata_up(L, 1, 1, SAULARRAY_TNAME);
+    int isint;
+    lua_Integer i = lua_tointegerx(L, 2, &isint);
+
+    if (isint) {
+        if (i >= 1 && i <= a->len) {
+            lua_pushnumber(L, a->data[i - 1]);
+        } else {
+            lua_pushnil(L);
+        }
+    } else {
+        lua_pushvalue(L, 2);
+        lua_gettable(L, lua_upvalueindex(2));
+    }
+
+    return 1;
+}
+
+static int array_newindex(lua_State *L)
+{
+    saul_array_t *a = lua_checkudata_up(L, 1, 1, SAULARRAY_TNAME);
+    lua_Integer i = luaL_checkinteger(L, 2);
+
+    luaL_argcheck(L, i >= 1 && i <= a->len, 2, "Out of range");
+
+    a->data[i - 1] = luaL_checknumber(L, 3);
+
+    return 0;
+}
+
+static int array_len(lua_State *L)
+{
+    saul_array_t *a = lua_checkudata_up(L, 1, 1, SAULARRAY_TNAME);
+
+    lua_pushinteger(L, a->len);
+
+    return 1;
+}
+
+static const luaL_Reg array_methods[] = {
+    {"stats", array_stats},
+    {"ema", array_ema},
+    {"fill", array_fill},
+    {NULL, NULL}
+};
+
+static const luaL_Reg array_meta[] = {
+    {"__index", array_index},
+    {"__newindex", array_newindex},
+    {"__len", array_len},
+    {NULL, NULL}
+};
+
+void lua_saul_openarray(lua_State *L)
+{
+    if (luaL_newmetatable(L, SAULARRAY_TNAME)) {
+        /* methods and metamethods get the metatable as upvalue for fast type
+         * checks; __index also gets the methods table. */
+        lua_newlib_up(L, array_methods, -1);
+        lua_pushvalue(L, -2);
+        lua_insert(L, -2);
+        luaL_setfuncs(L, array_meta, 2);
+    }
+}
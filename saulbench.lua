@@ -0,0 +1,90 @@
+--[[
+   @file saulbench.lua
+   @brief   Benchmark for the SAUL registry bindings.
+   @author  agent <agent@local>
+   Copyright (C) 2026 agent. Distributed under the GNU Lesser General Public License v2.1.
+
+   Best used with the synthetic devices (make SAUL_FARM=<n>). Usage:
+
+       L> require"saulbench".run(100)
+
+   Times are reported in microseconds per operation, with the loop overhead
+   subtracted.
+]]
+
+local riot = require"riot"
+local saul = require"saul"
+
+local function timeit(n, f, ...)
+    local t0 = riot.now_us()
+    for _ = 1, n do
+        f(...)
+    end
+    return (riot.now_us() - t0) / n
+end
+
+local function nop() end
+
+local function report(results, name, t)
+    results[name] = t
+    print(string.format("%-24s %10.2f us", name, t))
+end
+
+local function run(n, prefix)
+    n = n or 100
+    prefix = prefix or "farm"
+
+    local results = {}
+    local names = {}
+    local devs = {}
+    local overhead = timeit(n, nop)
+
+    -- The first lookup of each name populates the device cache.
+    local t0 = riot.now_us()
+    while true do
+        local dev = saul[prefix..#names]
+        if not dev then
+            break
+        end
+        names[#names+1] = prefix..#names
+        devs[#devs+1] = dev
+    end
+
+    if #devs == 0 then
+        print("No devices named "..prefix.."<n> found")
+        return results
+    end
+
+    report(results, "find_name (cold)", (riot.now_us() - t0) / #devs)
+    print(string.format("%d devices, %d iterations", #devs, n))
+
+    local function lookup(name) return saul[name] end
+
+    report(results, "find_name first",
+           timeit(n, lookup, names[1]) - overhead)
+    report(results, "find_name last",
+           timeit(n, lookup, names[#names]) - overhead)
+    report(results, "find_name missing",
+           timeit(n, lookup, "nonexistent") - overhead)
+
+    local types = saul.types()
+    local t_type = 0
+    for i = 0, #types do
+        t_type = t_type + timeit(n, saul.find_type, types[i]) - overhead
+    end
+    report(results, "find_type (avg)", t_type / (#types + 1))
+
+    local function read_all()
+        for i = 1, #devs do
+            devs[i]:read()
+        end
+    end
+
+    report(results, "read (avg)", (timeit(n, read_all) - overhead) / #devs)
+    report(results, "get_name", timeit(n, devs[1].get_name, devs[1]) - overhead)
+    report(results, "get_type", timeit(n, devs[1].get_type, devs[1]) - overhead)
+
+    return results
+end
+
+return {run = run}
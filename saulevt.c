@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Change notifications for SAUL devices.
+ *
+ * GPIO inputs registered by saul_gpio are watched with interrupts. Other
+ * devices are read by a C thread every SAUL_EVT_POLL_MS and generate an event
+ * when the first value changes by more than a threshold.
+ *
+ * Events are timestamped when they happen and stored in a fixed size queue
+ * that is drained by the interpreter in saul.events(), which also dispatches
+ * the callbacks. The queue is written from interrupts and from the polling
+ * thread (producers are serialized by disabling interrupts for a few
+ * instructions) and read without locks by the interpreter thread.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "irq.h"
+#include "mutex.h"
+#include "thread.h"
+#include "xtimer.h"
+#include "saul_reg.h"
+#include "lua_saul.h"
+
+#ifdef MODULE_SAUL_GPIO
+#include "periph/gpio.h"
+#include "saul/periph.h"
+#endif
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lua_idlegc.h"
+
+#define WATCHERS_TABLE "_saul_watchers"
+
+#define GUARD_KEY "_saul_evt_guard"
+
+/* Must be a power of two */
+#ifndef SAUL_EVT_QUEUE_LEN
+#define SAUL_EVT_QUEUE_LEN (16)
+#endif
+
+#ifndef SAUL_EVT_MAX_WATCH
+#define SAUL_EVT_MAX_WATCH (8)
+#endif
+
+#ifndef SAUL_EVT_POLL_MS
+#define SAUL_EVT_POLL_MS (50)
+#endif
+
+#ifndef SAUL_EVT_PRIO
+#define SAUL_EVT_PRIO (THREAD_PRIORITY_MAIN - 1)
+#endif
+
+enum WATCH_KIND { WATCH_NONE, WATCH_GPIO, WATCH_POLL };
+
+typedef struct {
+    saul_reg_t *dev;
+    uint8_t kind;
+    float threshold;
+    float last;
+    bool has_last;
+} watcher_t;
+
+typedef struct {
+    uint32_t time;
+    saul_reg_t *dev;    /**< Device the watcher had when the event happened */
+    uint8_t watcher;
+    float value;
+} saul_evt_t;
+
+static watcher_t watchers[SAUL_EVT_MAX_WATCH];
+
+static saul_evt_t queue[SAUL_EVT_QUEUE_LEN];
+static volatile unsigned q_head;   /**< Written by producers */
+static volatile unsigned q_tail;   /**< Written by the consumer */
+static volatile uint32_t q_dropped;
+
+static mutex_t evt_avail = MUTEX_INIT_LOCKED;
+static mutex_t poll_wakeup = MUTEX_INIT_LOCKED;
+static kernel_pid_t poll_pid = KERNEL_PID_UNDEF;
+static char poll_stack[THREAD_STACKSIZE_DEFAULT];
+
+#ifdef MODULE_SAUL_GPIO
+extern const saul_driver_t gpio_in_saul_driver;
+#endif
+
+static void _push(uint8_t watcher, saul_reg_t *dev, float value)
+{
+    unsigned state = irq_disable();
+    unsigned head = q_head;
+
+    if (head - q_tail >= SAUL_EVT_QUEUE_LEN) {
+        q_dropped++;
+    } else {
+        queue[head % SAUL_EVT_QUEUE_LEN].time = xtimer_now_usec();
+        queue[head % SAUL_EVT_QUEUE_LEN].dev = dev;
+        queue[head % SAUL_EVT_QUEUE_LEN].watcher = watcher;
+        queue[head % SAUL_EVT_QUEUE_LEN].value = value;
+        q_head = head + 1;
+    }
+
+    irq_restore(state);
+
+    mutex_unlock(&evt_avail);
+}
+
+#ifdef MODULE_SAUL_GPIO
+static void _gpio_cb(void *arg)
+{
+    watcher_t *w = arg;
+    phydat_t data;
+    float value;
+
+    /* Read through the driver, like dev:read(), so that inverted inputs are
+     * reported correctly */
+    if (saul_reg_read(w->dev, &data) > 0) {
+        lua_saul_phydat2float(&data, 1, &value);
+        _push(w - watchers, w->dev, value);
+    }
+}
+#endif
+
+static void *_poll_thread(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        xtimer_ticks32_t last_wakeup;
+        bool active;
+
+        mutex_lock(&poll_wakeup);
+        last_wakeup = xtimer_now();
+
+        do {
+            unsigned int i;
+
+            active = false;
+
+            for (i = 0; i < SAUL_EVT_MAX_WATCH; i++) {
+                watcher_t *w = &watchers[i];
+                phydat_t data;
+                float value;
+
+                if (w->kind != WATCH_POLL) {
+                    continue;
+                }
+                active = true;
+
+                data.scale = 0;
+                if (saul_reg_read(w->dev, &data) <= 0) {
+                    continue;
+                }
+                lua_saul_phydat2float(&data, 1, &value);
+
+                if (!w->has_last || fabsf(value - w->last) > w->threshold) {
+                    if (w->has_last) {
+                        _push(i, w->dev, value);
+                    }
+                    w->last = value;
+                    w->has_last = true;
+                }
+            }
+
+            if (active) {
+                xtimer_periodic_wakeup(&last_wakeup, SAUL_EVT_POLL_MS * US_PER_MS);
+            }
+        } while (active);
+    }
+
+    return NULL;
+}
+
+static void _unwatch(watcher_t *w)
+{
+#ifdef MODULE_SAUL_GPIO
+    if (w->kind == WATCH_GPIO) {
+        const saul_gpio_params_t *p = w->dev->dev;
+        gpio_irq_disable(p->pin);
+    }
+#endif
+    w->kind = WATCH_NONE;
+    w->dev = NULL;
+}
+
+/**
+ * Call fn(dev, value, time_us) whenever the device changes.
+ *
+ * Callbacks are only run from saul.events().
+ *
+ * GPIO inputs are watched with interrupts (both edges). Other devices are
+ * polled every SAUL_EVT_POLL_MS and an event is generated when the first
+ * value changes by more than the threshold (or changes at all, if it is 0).
+ *
+ * @param   dev         SAUL device object.
+ * @param   fn          Callback, or nil to stop watching the device.
+ * @param   threshold   (optional) Minimum change, for polled devices.
+ */
+int lua_saul_on_change(lua_State *L)
+{
+    saul_reg_t *dev = lua_saul_checkdev(L, 1);
+    float threshold = luaL_optnumber(L, 3, 0);
+    watcher_t *w = NULL;
+    unsigned int i;
+
+    if (!lua_isnil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TFUNCTION);
+    }
+
+    for (i = 0; i < SAUL_EVT_MAX_WATCH; i++) {
+        if (watchers[i].kind != WATCH_NONE && watchers[i].dev == dev) {
+            w = &watchers[i];
+            break;
+        } else if (w == NULL && watchers[i].kind == WATCH_NONE) {
+            w = &watchers[i];
+        }
+    }
+
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, WATCHERS_TABLE);
+
+    if (lua_isnil(L, 2)) {
+        if (w != NULL && w->dev == dev) {
+            _unwatch(w);
+            lua_pushnil(L);
+            lua_rawseti(L, -2, w - watchers);
+        }
+        return 0;
+    }
+
+    if (w == NULL) {
+        return luaL_error(L, "Too many watched devices");
+    }
+
+    /* Keep the callback and the device object in the registry */
+    lua_createtable(L, 2, 0);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, 1);
+    lua_pushvalue(L, 1);
+    lua_rawseti(L, -2, 2);
+    lua_rawseti(L, -2, w - watchers);
+
+    if (w->kind != WATCH_NONE) {
+        /* Already watched, only replace the callback and the threshold */
+        w->threshold = threshold;
+        return 0;
+    }
+
+    w->dev = dev;
+    w->threshold = threshold;
+    w->has_last = false;
+
+#ifdef MODULE_SAUL_GPIO
+    if (dev->driver == &gpio_in_saul_driver) {
+        const saul_gpio_params_t *p = dev->dev;
+
+        if (gpio_init_int(p->pin, p->mode, GPIO_BOTH, _gpio_cb, w) < 0) {
+            w->dev = NULL;
+            return luaL_error(L, "Cannot enable interrupt");
+        }
+        w->kind = WATCH_GPIO;
+        return 0;
+    }
+#endif
+
+    if (poll_pid == KERNEL_PID_UNDEF) {
+        poll_pid = thread_create(poll_stack, sizeof(poll_stack), SAUL_EVT_PRIO,
+                                 THREAD_CREATE_STACKTEST, _poll_thread, NULL,
+                                 "saul_evt");
+        if (poll_pid < 0) {
+            poll_pid = KERNEL_PID_UNDEF;
+            w->dev = NULL;
+            return luaL_error(L, "Cannot start polling thread");
+        }
+    }
+
+    w->kind = WATCH_POLL;
+    mutex_unlock(&poll_wakeup);
+
+    return 0;
+}
+
+/**
+ * Dispatch pending events, waiting for them if there are none.
+ *
+ * Part of the waiting time is used for garbage collection (see riot.idle_gc).
+ *
+ * @param   timeout_ms  (optional) Maximum time to wait. 0 returns immediately
+ *                      and -1 (the default) waits forever.
+ *
+ * @return  Number of events dispatched, followed by the number of events that
+ *          were lost because the queue was full since the last call.
+ */
+int lua_saul_events(lua_State *L)
+{
+    lua_Integer timeout = luaL_optinteger(L, 1, -1);
+    int n = 0;
+    uint32_t dropped;
+    unsigned state;
+
+    if (q_head == q_tail && timeout != 0) {
+        uint32_t max_us = (timeout < 0) ? UINT32_MAX : timeout * US_PER_MS;
+        uint32_t spent = lua_idle_gc(L, max_us);
+
+        /* Events may have arrived while collecting */
+        if (q_head == q_tail) {
+            if (timeout < 0) {
+                mutex_lock(&evt_avail);
+            } else if (spent < max_us) {
+                xtimer_mutex_lock_timeout(&evt_avail, max_us - spent);
+            }
+        }
+    }
+    /* Consume the wakeup, the queue is drained below anyway */
+    mutex_trylock(&evt_avail);
+
+    luaL_getsubtable(L, LUA_REGISTRYINDEX, WATCHERS_TABLE);
+
+    while (q_head != q_tail) {
+        saul_evt_t evt = queue[q_tail % SAUL_EVT_QUEUE_LEN];
+
+        q_tail = q_tail + 1;
+
+        /* Skip events of devices that are no longer watched, even if the
+         * watcher has been reused for another device */
+        if (watchers[evt.watcher].kind == WATCH_NONE
+            || watchers[evt.watcher].dev != evt.dev) {
+            continue;
+        }
+        if (lua_rawgeti(L, -1, evt.watcher) != LUA_TTABLE) {
+            lua_pop(L, 1);
+            continue;
+        }
+
+        lua_rawgeti(L, -1, 1);
+        lua_rawgeti(L, -2, 2);
+        lua_pushnumber(L, evt.value);
+        lua_pushinteger(L, evt.time);
+        lua_call(L, 3, 0);
+        lua_pop(L, 1);
+        n++;
+    }
+
+    state = irq_disable();
+    dropped = q_dropped;
+    q_dropped = 0;
+    irq_restore(state);
+
+    lua_pushinteger(L, n);
+    lua_pushinteger(L, dropped);
+
+    return 2;
+}
+
+/* Stop watching all devices and discard pending events */
+static void _unwatch_all(void)
+{
+    unsigned int i;
+    unsigned state;
+
+    for (i = 0; i < SAUL_EVT_MAX_WATCH; i++) {
+        if (watchers[i].kind != WATCH_NONE) {
+            _unwatch(&watchers[i]);
+        }
+    }
+
+    state = irq_disable();
+    q_tail = q_head;
+    q_dropped = 0;
+    irq_restore(state);
+
+    mutex_trylock(&evt_avail);
+}
+
+static int _guard_gc(lua_State *L)
+{
+    (void)L;
+
+    _unwatch_all();
+
+    return 0;
+}
+
+void lua_saul_events_open(lua_State *L)
+{
+    /* The callbacks live in the registry of the state that registered them,
+     * so watchers left by a previous state that was not closed are useless. A
+     * userdata in the registry stops everything when this state closes. */
+    if (lua_getfield(L, LUA_REGISTRYINDEX, GUARD_KEY) == LUA_TNIL) {
+        _unwatch_all();
+
+        lua_newuserdata(L, 1);
+        lua_createtable(L, 0, 1);
+        lua_pushcfunction(L, _guard_gc);
+        lua_setfield(L, -2, "__gc");
+        lua_setmetatable(L, -2);
+        lua_setfield(L, LUA_REGISTRYINDEX, GUARD_KEY);
+    }
+    lua_pop(L, 1);
+}
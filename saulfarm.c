@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     examples
+ * @{
+ *
+ * @file
+ * @brief       Synthetic SAUL devices for testing and benchmarking.
+ *
+ * Registers SAUL_FARM_N fake devices named "farm0", "farm1", ... cycling
+ * through all the SAUL device types. Sensors produce a deterministic
+ * waveform: the n-th read of a given device always returns the same value,
+ * independently of timing. Actuators read back the last value written.
+ *
+ * Each read can be delayed by SAUL_FARM_LATENCY_US to emulate slow buses.
+ *
+ * Enable with "make SAUL_FARM=<number of devices>".
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#ifdef SAUL_FARM_N
+
+#include <stdio.h>
+#include <string.h>
+
+#include "saul.h"
+#include "saul_reg.h"
+#include "xtimer.h"
+
+#ifndef SAUL_FARM_LATENCY_US
+#define SAUL_FARM_LATENCY_US (0)
+#endif
+
+#define N_ELEM(a) (sizeof(a)/sizeof(*(a)))
+
+/* Length of the waveforms, in samples */
+#define FARM_PERIOD (64)
+#define FARM_AMPLITUDE (1000)
+
+#define FARM_NAME_LEN (sizeof("farm") + 5)
+
+enum FARM_WAVE { WAVE_TRIANGLE, WAVE_SQUARE, WAVE_SAWTOOTH, WAVE_NUMOF };
+
+typedef struct {
+    uint32_t nread;
+    uint16_t index;
+    phydat_t written;
+} farm_dev_t;
+
+static const uint8_t farm_types[] = {
+    SAUL_ACT_ANY, SAUL_ACT_DIMMER, SAUL_ACT_LED_RGB, SAUL_ACT_MOTOR,
+    SAUL_ACT_SERVO, SAUL_ACT_SWITCH, SAUL_CLASS_ANY, SAUL_CLASS_UNDEF,
+    SAUL_SENSE_ACCEL, SAUL_SENSE_ANALOG, SAUL_SENSE_ANY, SAUL_SENSE_BTN,
+    SAUL_SENSE_CO2, SAUL_SENSE_COLOR, SAUL_SENSE_COUNT, SAUL_SENSE_DISTANCE,
+    SAUL_SENSE_GYRO, SAUL_SENSE_HUM, SAUL_SENSE_LIGHT, SAUL_SENSE_MAG,
+    SAUL_SENSE_OBJTEMP, SAUL_SENSE_OCCUP, SAUL_SENSE_PRESS, SAUL_SENSE_TEMP,
+    SAUL_SENSE_TVOC, SAUL_SENSE_UV,
+};
+
+static saul_driver_t farm_drivers[N_ELEM(farm_types)];
+static farm_dev_t farm_devs[SAUL_FARM_N];
+static saul_reg_t farm_regs[SAUL_FARM_N];
+static char farm_names[SAUL_FARM_N][FARM_NAME_LEN];
+
+static int _dimensions(uint8_t type)
+{
+    switch (type) {
+        case SAUL_SENSE_ACCEL:
+        case SAUL_SENSE_GYRO:
+        case SAUL_SENSE_MAG:
+        case SAUL_SENSE_COLOR:
+        case SAUL_ACT_LED_RGB:
+            return 3;
+        default:
+            return 1;
+    }
+}
+
+static int16_t _wave(unsigned wave, uint32_t n)
+{
+    uint32_t phase = n % FARM_PERIOD;
+
+    switch (wave) {
+        case WAVE_SQUARE:
+            return (phase < FARM_PERIOD / 2) ? FARM_AMPLITUDE : -FARM_AMPLITUDE;
+        case WAVE_SAWTOOTH:
+            return -FARM_AMPLITUDE + (2 * FARM_AMPLITUDE * phase) / FARM_PERIOD;
+        case WAVE_TRIANGLE: /* falls through */
+        default:
+            if (phase < FARM_PERIOD / 2) {
+                return -FARM_AMPLITUDE + (4 * FARM_AMPLITUDE * phase) / FARM_PERIOD;
+            } else {
+                return 3 * FARM_AMPLITUDE
+                       - (4 * FARM_AMPLITUDE * phase) / FARM_PERIOD;
+            }
+    }
+}
+
+static int _farm_read(const void *dev, phydat_t *res)
+{
+    farm_dev_t *d = (farm_dev_t *)dev;
+    uint8_t type = farm_regs[d->index].driver->type;
+    int i, dim = _dimensions(type);
+
+    if (SAUL_FARM_LATENCY_US > 0) {
+        xtimer_usleep(SAUL_FARM_LATENCY_US);
+    }
+
+    if ((type & (SAUL_ACT_ANY | SAUL_SENSE_ANY)) == SAUL_ACT_ANY) {
+        *res = d->written;
+        return dim;
+    }
+
+    /* Each device starts at a different phase and each axis is shifted by a
+     * quarter of a period. */
+    for (i = 0; i < dim; i++) {
+        res->val[i] = _wave(d->index % WAVE_NUMOF,
+                            d->nread + d->index + i * FARM_PERIOD / 4);
+    }
+    res->unit = UNIT_UNDEF;
+    res->scale = -(d->index % 3);
+
+    d->nread++;
+
+    return dim;
+}
+
+static int _farm_write(const void *dev, phydat_t *data)
+{
+    farm_dev_t *d = (farm_dev_t *)dev;
+
+    d->written = *data;
+
+    return _dimensions(farm_regs[d->index].driver->type);
+}
+
+int saul_farm_init(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < N_ELEM(farm_types); i++) {
+        farm_drivers[i].read = _farm_read;
+        farm_drivers[i].write = _farm_write;
+        farm_drivers[i].type = farm_types[i];
+    }
+
+    for (i = 0; i < SAUL_FARM_N; i++) {
+        snprintf(farm_names[i], FARM_NAME_LEN, "farm%u", i);
+
+        farm_devs[i].index = i;
+        farm_regs[i].dev = &farm_devs[i];
+        farm_regs[i].name = farm_names[i];
+        farm_regs[i].driver = &farm_drivers[i % N_ELEM(farm_types)];
+
+        if (saul_reg_add(&farm_regs[i]) < 0) {
+            return -1;
+        }
+    }
+
+    return SAUL_FARM_N;
+}
+
+#endif /* SAUL_FARM_N */
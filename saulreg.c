@@ -23,17 +23,18 @@
 #include "lprefix.h"
 
 #include "saul_reg.h"
+#include "lua_saul.h"
 
 #include "lua.h"
 #include "lauxlib.h"
 #include "lualib.h"
+#include "lua_udata.h"
 #include "binsearch.h"
 
 #include <math.h>
 #include <stdio.h>
 
 #define CACHE_TABLE "_devcache"
-#define SAULDEV_TNAME "saul_dev"
 
 #define MAX_ENUM_LEN 64
 #define N_ELEM(a) (sizeof(a)/sizeof(*(a)))
@@ -107,19 +108,37 @@ static void sauldev_to_lua(lua_State *L, saul_reg_t *dev)
     }
 }
 
+saul_reg_t *lua_saul_checkdev(lua_State *L, int arg)
+{
+    saul_reg_t **d = luaL_checkudata(L, arg, SAULDEV_TNAME);
+
+    return *d;
+}
+
+/**
+ * Like lua_saul_checkdev, for the functions of this module, which have the
+ * device metatable as first upvalue.
+ */
+static saul_reg_t *_checkdev(lua_State *L, int arg)
+{
+    saul_reg_t **d = lua_checkudata_up(L, arg, 1, SAULDEV_TNAME);
+
+    return *d;
+}
+
 static int get_name(lua_State *L)
 {
-    saul_reg_t **d = luaL_checkudata(L, 1, SAULDEV_TNAME);
+    saul_reg_t *d = _checkdev(L, 1);
 
-    lua_pushstring(L, (*d)->name);
+    lua_pushstring(L, d->name);
 
     return 1;
 }
 
 static int get_type(lua_State *L)
 {
-    saul_reg_t **d = luaL_checkudata(L, 1, SAULDEV_TNAME);
-    uint8_t type = (*d)->driver->type;
+    saul_reg_t *d = _checkdev(L, 1);
+    uint8_t type = d->driver->type;
     unsigned int i;
 
     for (i = 0; i < N_ELEM(devtype2code); i++) {
@@ -152,57 +171,87 @@ static float exp10fi(int exponent)
     return r;
 }
 
-/**
- * Write values to a device.
- *
- * This takes the device as first argument and up to three additional values.
- * Values are floating point numbers.
- *
- * On error returns nil and a message.
- *
- * This has a small bug. The most negative value in a phydat is unusable.
- */
-static int _write(lua_State *L)
+void lua_saul_float2phydat(const float *values, int n, phydat_t *data)
 {
-    int i, n_params = lua_gettop(L) - 1;
-    saul_reg_t **d = luaL_checkudata(L, 1, SAULDEV_TNAME);
-    phydat_t data = { { 0, 0, 0 }, 0, 0 };
+    int i;
     float maxabs = 0, scale_factor = 1.0;
 
-    for (i = 0; i < n_params; i++) {
-        lua_Number n = fabsf(luaL_checknumber(L, i + 2));
+    data->scale = 0;
 
-        maxabs = fmaxf(maxabs, n);
+    for (i = 0; i < PHYDAT_DIM; i++) {
+        data->val[i] = 0;
+    }
+
+    for (i = 0; i < n; i++) {
+        maxabs = fmaxf(maxabs, fabsf(values[i]));
     }
 
     /* Optimize dynamic range */
     /* super hacky hack: if there is only one parameter and it is an integer
      * that fits in the range, live it as is.*/
-    if (n_params == 1 && maxabs == roundf(maxabs)) {
+    if (n == 1 && maxabs == roundf(maxabs)) {
         scale_factor = 1;
     } else {
         if (maxabs > PHYDAT_MAX) {
             while (maxabs > PHYDAT_MAX) {
                 maxabs /= 10;
-                data.scale += 1;
+                data->scale += 1;
             }
         } else {
             while (maxabs != 0 && maxabs * 10.0 < PHYDAT_MAX) {
                 maxabs *= 10;
-                data.scale -= 1;
+                data->scale -= 1;
             }
         }
 
-        scale_factor = exp10fi(data.scale);
+        scale_factor = exp10fi(data->scale);
     }
 
-    for (i = 0; i < n_params; i++) {
-        lua_Number n = lua_tonumber(L, i + 2);
+    for (i = 0; i < n; i++) {
+        data->val[i] = values[i]/scale_factor;
+    }
+}
+
+int lua_saul_phydat2float(const phydat_t *data, int n, float *values)
+{
+    int i;
+    float fscale = exp10fi(data->scale);
+
+    for (i = 0; i < n; i++) {
+        values[i] = data->val[i] * fscale;
+    }
+
+    return n;
+}
 
-        data.val[i] = n/scale_factor;
+/**
+ * Write values to a device.
+ *
+ * This takes the device as first argument and up to three additional values.
+ * Values are floating point numbers.
+ *
+ * On error returns nil and a message.
+ *
+ * This has a small bug. The most negative value in a phydat is unusable.
+ */
+static int _write(lua_State *L)
+{
+    int i, n_params = lua_gettop(L) - 1;
+    saul_reg_t *d = _checkdev(L, 1);
+    phydat_t data;
+    float values[PHYDAT_DIM];
+
+    luaL_argcheck(L, n_params <= PHYDAT_DIM, PHYDAT_DIM + 2, "Too many values");
+
+    for (i = 0; i < n_params; i++) {
+        values[i] = luaL_checknumber(L, i + 2);
     }
 
-    int nprocessed = saul_reg_write(*d, &data);
+    lua_saul_float2phydat(values, n_params, &data);
+
+    int nprocessed = saul_reg_write(d, &data);
+
+    lua_saul_actuator_written(d, (nprocessed >= 0) ? &data : NULL);
 
     if (nprocessed >= 0) {
         lua_pushinteger(L, nprocessed);
@@ -221,12 +270,12 @@ static int _write(lua_State *L)
  */
 static int _read(lua_State *L)
 {
-    saul_reg_t **d = luaL_checkudata(L, 1, SAULDEV_TNAME);
+    saul_reg_t *d = _checkdev(L, 1);
     phydat_t data;
     int n, nread;
 
     data.scale = 0;
-    nread = saul_reg_read(*d, &data);
+    nread = saul_reg_read(d, &data);
 
     if (nread < 0) {
         lua_pushnil(L);
@@ -243,11 +292,90 @@ static int _read(lua_State *L)
     return nread;
 }
 
+/**
+ * Store values in a table or numeric array (see saul.array).
+ *
+ * @param   out     Stack index of the table or array.
+ * @param   pos     Index of the first value.
+ */
+static void _store(lua_State *L, int out, lua_Integer pos,
+                   const float *values, int n)
+{
+    lua_Integer len;
+    float *array = lua_saul_toarray(L, out, 2, &len);
+    int i;
+
+    if (array != NULL) {
+        if (pos < 1 || pos - 1 + n > len) {
+            luaL_error(L, "Array too small");
+        }
+        for (i = 0; i < n; i++) {
+            array[pos - 1 + i] = values[i];
+        }
+    } else {
+        for (i = 0; i < n; i++) {
+            lua_pushnumber(L, values[i]);
+            lua_rawseti(L, out, pos + i);
+        }
+    }
+}
+
+static void _check_output(lua_State *L, int arg)
+{
+    if (!lua_testudata_up(L, arg, 2, SAULARRAY_TNAME)) {
+        luaL_checktype(L, arg, LUA_TTABLE);
+    }
+}
+
+/**
+ * Read the device, storing the values in a table or numeric array.
+ *
+ * When reading into an array, or a table that already has the elements, no
+ * new objects are created.
+ *
+ * @param   dev
+ * @param   out     Table or numeric array (see saul.array).
+ * @param   offset  (optional) Index for the first value. Default 1.
+ *
+ * @return  Number of values stored, or nil and an error message.
+ */
+static int _read_into(lua_State *L)
+{
+    saul_reg_t *d = _checkdev(L, 1);
+    lua_Integer offset = luaL_optinteger(L, 3, 1);
+    phydat_t data;
+    float values[PHYDAT_DIM];
+    int nread;
+
+    _check_output(L, 2);
+
+    data.scale = 0;
+    nread = saul_reg_read(d, &data);
+
+    if (nread < 0) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "error %d", nread);
+        return 2;
+    }
+
+    lua_saul_phydat2float(&data, nread, values);
+    _store(L, 2, offset, values, nread);
+
+    lua_pushinteger(L, nread);
+
+    return 1;
+}
+
 static const luaL_Reg saul_dev_methods[] = {
     {"get_name", get_name},
     {"get_type", get_type},
     {"read", _read},
+    {"read_into", _read_into},
     {"write", _write},
+    {"ramp", lua_saul_ramp},
+    {"write_coalesced", lua_saul_write_coalesced},
+    {"busy", lua_saul_busy},
+    {"on_change", lua_saul_on_change},
     {NULL, NULL}
 };
 
@@ -311,6 +439,76 @@ static int all_types(lua_State *L)
 }
 
 
+/**
+ * Read several devices, storing all the values one after the other.
+ *
+ * @param   devs    Sequence of devices.
+ * @param   out     Table or numeric array (see saul.array).
+ * @param   offset  (optional) Index for the first value. Default 1.
+ *
+ * @return  Total number of values stored, or nil and an error message.
+ */
+static int read_many(lua_State *L)
+{
+    lua_Integer start = luaL_optinteger(L, 3, 1);
+    lua_Integer pos = start;
+    lua_Integer i, ndevs;
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+    _check_output(L, 2);
+
+    ndevs = lua_rawlen(L, 1);
+
+    for (i = 1; i <= ndevs; i++) {
+        saul_reg_t **d;
+        phydat_t data;
+        float values[PHYDAT_DIM];
+        int nread;
+
+        lua_rawgeti(L, 1, i);
+        d = lua_testudata_up(L, -1, 1, SAULDEV_TNAME);
+        lua_pop(L, 1);
+
+        if (d == NULL) {
+            return luaL_error(L, "Element %d is not a device", (int)i);
+        }
+
+        data.scale = 0;
+        nread = saul_reg_read(*d, &data);
+
+        if (nread < 0) {
+            lua_pushnil(L);
+            lua_pushfstring(L, "error %d reading device %d", nread, (int)i);
+            return 2;
+        }
+
+        lua_saul_phydat2float(&data, nread, values);
+        _store(L, 2, pos, values, nread);
+        pos += nread;
+    }
+
+    lua_pushinteger(L, pos - start);
+
+    return 1;
+}
+
+#ifdef SAUL_FARM_N
+/* Type checks alone, so that udatabench can time both paths in one build */
+static int _bench_check_up(lua_State *L)
+{
+    _checkdev(L, 1);
+
+    return 0;
+}
+
+static int _bench_check_registry(lua_State *L)
+{
+    luaL_checkudata(L, 1, SAULDEV_TNAME);
+
+    return 0;
+}
+#endif
+
 /* For this module we are going to cheat and provide the contents via metatable
  * methods. There's not point in populating the table with all devices, and we
  * already have functions for searching provided by saul_reg.
@@ -319,6 +517,14 @@ static int all_types(lua_State *L)
 static const luaL_Reg funcs[] = {
   {"find_type", find_type},
   {"types", all_types},
+  {"actuator_stats", lua_saul_actuator_stats},
+  {"events", lua_saul_events},
+  {"read_many", read_many},
+  {"array", lua_saul_array},
+#ifdef SAUL_FARM_N
+  {"_bench_check_up", _bench_check_up},
+  {"_bench_check_registry", _bench_check_registry},
+#endif
   {"__index", _index},
   /* placeholders */
   {NULL, NULL}
@@ -331,11 +537,24 @@ static const luaL_Reg funcs[] = {
  */
 int luaopen_saul(lua_State *L)
 {
-    if (luaL_newmetatable(L, SAULDEV_TNAME)) {
-        luaL_setfuncs(L, saul_dev_methods, 0);
-        lua_setfield(L, -1, "__index");
+    int new_mt = luaL_newmetatable(L, SAULDEV_TNAME);
+
+    lua_saul_openarray(L);
+
+    /* The methods and the module functions get the metatables of devices and
+     * arrays as upvalues 1 and 2 for fast type checks */
+    if (new_mt) {
+        lua_pushvalue(L, -2);
+        lua_pushvalue(L, -1);
+        lua_pushvalue(L, -3);
+        luaL_setfuncs(L, saul_dev_methods, 2);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -2, "__index");
+        lua_pop(L, 1);
     }
 
+    lua_saul_events_open(L);
+
     lua_newtable(L);
 
     lua_createtable(L, 0, 1);
@@ -345,9 +564,16 @@ int luaopen_saul(lua_State *L)
 
     lua_setfield(L, LUA_REGISTRYINDEX, CACHE_TABLE);
 
-    luaL_newlib(L, funcs);
+    luaL_newlibtable(L, funcs);
+    lua_pushvalue(L, -3);
+    lua_pushvalue(L, -3);
+    luaL_setfuncs(L, funcs, 2);
     lua_pushvalue(L, -1);
     lua_setmetatable(L, -2);
 
+    /* Leave only the module table */
+    lua_insert(L, -3);
+    lua_pop(L, 2);
+
     return 1;
 }
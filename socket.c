@@ -24,12 +24,17 @@
 
 #include "lprefix.h"
 
+#include <errno.h>
+
+#include "net/ipv6/addr.h"
 #include "net/sock/udp.h"
 #include "net/sock/util.h"
 
 #include "lua.h"
 #include "lauxlib.h"
 #include "lualib.h"
+#include "lua_udata.h"
+#include "lua_idlegc.h"
 
 /* MetaTable names */
 #define SOCK_UDP_TNAME "sock_udp"
@@ -133,6 +138,26 @@ static enum EP_PARSE_RESULT _parse_udp_endpoint(lua_State *L, int index, sock_ud
     }
 }
 
+/**
+ * Store an endpoint in the table at the given index.
+ */
+static void _ep2table(lua_State *L, int index, const sock_udp_ep_t *ep)
+{
+    char addr[IPV6_ADDR_MAX_STR_LEN];
+
+    if (ipv6_addr_to_str(addr, (const ipv6_addr_t *)&ep->addr.ipv6,
+                         sizeof(addr)) != NULL) {
+        lua_pushstring(L, addr);
+        lua_setfield(L, index, "address");
+    }
+
+    lua_pushinteger(L, ep->port);
+    lua_setfield(L, index, "port");
+
+    lua_pushinteger(L, ep->netif);
+    lua_setfield(L, index, "netif");
+}
+
 /**
  * Create a new UDP socket.
  *
@@ -201,7 +226,9 @@ static int udp_new(lua_State *L)
         return 2;
     }
 
-    luaL_setmetatable(L, SOCK_UDP_TNAME);
+    /* The metatable is the first upvalue */
+    lua_pushvalue(L, lua_upvalueindex(1));
+    lua_setmetatable(L, -2);
 
     return 1;
 }
@@ -212,14 +239,19 @@ static int udp_new(lua_State *L)
  * @param   sock
  * @param   n              Receive up to n bytes.
  * @param   timeout_ms     Use 0 to return immediately, -1 for no timeout.
- * @param   remote (optional) remote end point.
+ * @param   remote (optional) remote end point. If it is a table, the
+ *                         address, port and netif of the sender are stored in
+ *                         it.
+ *
+ * If no data is available immediately, part of the waiting time is used for
+ * garbage collection (see riot.idle_gc).
  *
  * @return  Received data as string, or nil+error message.
  */
 static int udp_recv(lua_State *L)
 {
     /* s cannot be NULL */
-    sock_udp_t *s = luaL_checkudata(L, 1, SOCK_UDP_TNAME);
+    sock_udp_t *s = lua_checkudata_up(L, 1, 1, SOCK_UDP_TNAME);
     int n = luaL_checkinteger(L, 2);
     int timeout = luaL_checkinteger(L, 3);
     sock_udp_ep_t remote, *premote;
@@ -241,7 +273,16 @@ static int udp_recv(lua_State *L)
      * preallocate and then shrink a string in lua.
      */
     void *buf = lua_newuserdata(L, n);
-    ssize_t nrecv = sock_udp_recv(s, buf, n, timeout, premote);
+    ssize_t nrecv = sock_udp_recv(s, buf, n, 0, premote);
+
+    if (nrecv == -EAGAIN && timeout != 0) {
+        uint32_t spent = lua_idle_gc(L, timeout);
+
+        if ((uint32_t)timeout != SOCK_NO_TIMEOUT) {
+            timeout = (spent < (uint32_t)timeout) ? timeout - spent : 0;
+        }
+        nrecv = sock_udp_recv(s, buf, n, timeout, premote);
+    }
 
     if (nrecv < 0) {
         lua_pop(L, 1);
@@ -251,6 +292,11 @@ static int udp_recv(lua_State *L)
     } else {
         lua_pushlstring(L, buf, nrecv);
         lua_replace(L, -2); /*this is to get rid of the userdata */
+
+        if (premote != NULL && lua_istable(L, 4)) {
+            _ep2table(L, 4, premote);
+        }
+
         return 1;
     }
 }
@@ -266,7 +312,7 @@ static int udp_recv(lua_State *L)
  */
 static int udp_send(lua_State *L)
 {
-    sock_udp_t *s = luaL_checkudata(L, 1, SOCK_UDP_TNAME);
+    sock_udp_t *s = lua_checkudata_up(L, 1, 1, SOCK_UDP_TNAME);
     size_t len;
     ssize_t sent;
     const char *data = luaL_checklstring(L, 2, &len);
@@ -303,7 +349,7 @@ static int udp_send(lua_State *L)
 static int udp_close(lua_State *L)
 {
     /* s cannot be NULL */
-    sock_udp_t *s = luaL_checkudata(L, 1, SOCK_UDP_TNAME);
+    sock_udp_t *s = lua_checkudata_up(L, 1, 1, SOCK_UDP_TNAME);
 
     sock_udp_close(s);
 
@@ -331,12 +377,13 @@ static const luaL_Reg funcs[] = {
  */
 int luaopen_socket(lua_State *L)
 {
+    /* All functions get the metatable as upvalue for fast type checks */
     if (luaL_newmetatable(L, SOCK_UDP_TNAME)) {
-        luaL_newlib(L, udp_methods);
+        lua_newlib_up(L, udp_methods, -1);
         lua_setfield(L, -2, "__index");
     }
 
-    luaL_newlib(L, funcs);
+    lua_newlib_up(L, funcs, -1);
 
     lua_pushinteger(L, SOCK_FLAGS_REUSE_EP);
     lua_setfield(L, -2, "REUSE_EP");
@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Buffered output for Lua.
+ *
+ * The interpreter thread is the only writer and the drain thread the only
+ * reader, so the ring buffer needs no locks. The mutexes are only used for
+ * waking up the other side.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mutex.h"
+#include "thread.h"
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+#include "lua_stdout.h"
+
+#define ORIG_TABLE "_stdout_orig"
+
+#ifndef LUA_STDOUT_PRIO
+#define LUA_STDOUT_PRIO (THREAD_PRIORITY_MIN - 1)
+#endif
+
+enum OUT_POLICY { POLICY_OFF, POLICY_BLOCK, POLICY_DROP };
+
+static const char *const policies[] = {"off", "block", "drop", NULL};
+
+static char out_buf[LUA_STDOUT_BUF_SIZE];
+static volatile unsigned out_head;  /**< Written by the interpreter */
+static volatile unsigned out_tail;  /**< Written by the drain thread */
+static uint8_t out_policy = POLICY_OFF;
+
+static mutex_t data_avail = MUTEX_INIT_LOCKED;
+static mutex_t space_avail = MUTEX_INIT_LOCKED;
+static kernel_pid_t drain_pid = KERNEL_PID_UNDEF;
+static char drain_stack[THREAD_STACKSIZE_DEFAULT + THREAD_EXTRA_STACKSIZE_PRINTF];
+
+static struct {
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t drops;
+    uint32_t blocked;
+    uint32_t flushes;
+    unsigned high_water;
+} stats;
+
+static void *_drain_thread(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        mutex_lock(&data_avail);
+
+        while (out_head != out_tail) {
+            unsigned tail = out_tail;
+            unsigned offset = tail % LUA_STDOUT_BUF_SIZE;
+            unsigned chunk = LUA_STDOUT_BUF_SIZE - offset;
+
+            if (chunk > out_head - tail) {
+                chunk = out_head - tail;
+            }
+
+            fwrite(out_buf + offset, 1, chunk, stdout);
+            fflush(stdout);
+
+            out_tail = tail + chunk;
+            mutex_unlock(&space_avail);
+        }
+    }
+
+    return NULL;
+}
+
+static void _put(const char *s, size_t len)
+{
+    if (out_policy == POLICY_DROP
+        && len > LUA_STDOUT_BUF_SIZE - (out_head - out_tail)) {
+        stats.dropped += len;
+        stats.drops++;
+        return;
+    }
+
+    stats.written += len;
+
+    while (len > 0) {
+        unsigned head = out_head;
+        unsigned used = head - out_tail;
+        unsigned offset = head % LUA_STDOUT_BUF_SIZE;
+        size_t n = LUA_STDOUT_BUF_SIZE - offset;
+
+        if (used == LUA_STDOUT_BUF_SIZE) {
+            stats.blocked++;
+            mutex_unlock(&data_avail);
+            mutex_lock(&space_avail);
+            continue;
+        }
+
+        if (n > LUA_STDOUT_BUF_SIZE - used) {
+            n = LUA_STDOUT_BUF_SIZE - used;
+        }
+        if (n > len) {
+            n = len;
+        }
+
+        memcpy(out_buf + offset, s, n);
+        out_head = head + n;
+        s += n;
+        len -= n;
+
+        if (used + n > stats.high_water) {
+            stats.high_water = used + n;
+        }
+    }
+
+    mutex_unlock(&data_avail);
+}
+
+void lua_stdout_flush(void)
+{
+    while (out_head != out_tail) {
+        mutex_unlock(&data_avail);
+        mutex_lock(&space_avail);
+    }
+}
+
+/* Replacement for print() */
+static int _print(lua_State *L)
+{
+    int n = lua_gettop(L);
+    int i;
+    luaL_Buffer b;
+
+    luaL_buffinit(L, &b);
+
+    for (i = 1; i <= n; i++) {
+        if (i > 1) {
+            luaL_addchar(&b, '\t');
+        }
+        luaL_tolstring(L, i, NULL);
+        luaL_addvalue(&b);
+    }
+    luaL_addchar(&b, '\n');
+
+    luaL_pushresult(&b);
+    _put(lua_tostring(L, -1), lua_rawlen(L, -1));
+
+    return 0;
+}
+
+/* Put arguments first..top into the buffer */
+static void _write_args(lua_State *L, int first)
+{
+    int n = lua_gettop(L);
+    int i;
+    luaL_Buffer b;
+
+    luaL_buffinit(L, &b);
+
+    for (i = first; i <= n; i++) {
+        size_t len;
+        const char *s = luaL_checklstring(L, i, &len);
+
+        luaL_addlstring(&b, s, len);
+    }
+
+    luaL_pushresult(&b);
+    _put(lua_tostring(L, -1), lua_rawlen(L, -1));
+}
+
+/* Replacement for io.write(). Upvalue 1 is io.stdout. */
+static int _write(lua_State *L)
+{
+    _write_args(L, 1);
+    lua_pushvalue(L, lua_upvalueindex(1));
+
+    return 1;
+}
+
+/* Replacement for the write method of files, so that io.stdout:write() is
+ * also buffered. Upvalue 1 is io.stdout and upvalue 2 the original method. */
+static int _file_write(lua_State *L)
+{
+    if (!lua_rawequal(L, 1, lua_upvalueindex(1))) {
+        lua_pushvalue(L, lua_upvalueindex(2));
+        lua_insert(L, 1);
+        lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+        return lua_gettop(L);
+    }
+
+    _write_args(L, 2);
+    lua_pushvalue(L, 1);
+
+    return 1;
+}
+
+/* Replacement for io.flush() */
+static int _flush(lua_State *L)
+{
+    stats.flushes++;
+    lua_stdout_flush();
+    lua_pushboolean(L, 1);
+
+    return 1;
+}
+
+/**
+ * Replace t[name] by f, saving the old value in orig[key].
+ *
+ * The @p nup upvalues of f are popped from the stack.
+ */
+static void _swap(lua_State *L, int t, int orig, const char *name,
+                  const char *key, lua_CFunction f, int nup)
+{
+    lua_pushcclosure(L, f, nup);
+    lua_getfield(L, t, name);
+    lua_setfield(L, orig, key);
+    lua_setfield(L, t, name);
+}
+
+/**
+ * Set t[name] back to orig[key].
+ */
+static void _restore(lua_State *L, int t, int orig, const char *name,
+                     const char *key)
+{
+    lua_getfield(L, orig, key);
+    lua_setfield(L, t, name);
+}
+
+/**
+ * Push the methods table of files.
+ *
+ * @return  Stack index of the table, or 0 if there is none.
+ */
+static int _file_methods(lua_State *L)
+{
+    if (luaL_getmetatable(L, LUA_FILEHANDLE) != LUA_TTABLE
+        || lua_getfield(L, -1, "__index") != LUA_TTABLE) {
+        return 0;
+    }
+
+    return lua_gettop(L);
+}
+
+static void _install(lua_State *L, int enable)
+{
+    int saved = lua_getfield(L, LUA_REGISTRYINDEX, ORIG_TABLE) != LUA_TNIL;
+    int orig = lua_gettop(L);
+    int g, io;
+
+    if (enable == saved) {
+        lua_settop(L, orig - 1);
+        return;
+    }
+
+    if (enable) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+    }
+
+    lua_pushglobaltable(L);
+    g = lua_gettop(L);
+    lua_getglobal(L, "io");
+    io = lua_gettop(L);
+
+    if (enable) {
+        _swap(L, g, orig, "print", "print", _print, 0);
+        if (lua_istable(L, io)) {
+            int m;
+
+            lua_getfield(L, io, "stdout");
+            _swap(L, io, orig, "write", "write", _write, 1);
+            _swap(L, io, orig, "flush", "flush", _flush, 0);
+
+            if ((m = _file_methods(L)) != 0) {
+                lua_getfield(L, io, "stdout");
+                lua_getfield(L, m, "write");
+                _swap(L, m, orig, "write", "file_write", _file_write, 2);
+            }
+        }
+        lua_pushvalue(L, orig);
+    } else {
+        _restore(L, g, orig, "print", "print");
+        if (lua_istable(L, io)) {
+            int m;
+
+            _restore(L, io, orig, "write", "write");
+            _restore(L, io, orig, "flush", "flush");
+
+            if ((m = _file_methods(L)) != 0) {
+                _restore(L, m, orig, "write", "file_write");
+            }
+        }
+        lua_pushnil(L);
+    }
+    lua_setfield(L, LUA_REGISTRYINDEX, ORIG_TABLE);
+
+    lua_settop(L, orig - 1);
+}
+
+/**
+ * Redirect print, io.write, io.stdout:write and io.flush to a buffer that is
+ * written to stdout in the background.
+ *
+ * io.flush waits until the buffer is empty.
+ *
+ * @param   policy  (optional) What to do when the buffer is full:
+ *                  "block" (default) waits for space, "drop" discards the
+ *                  output (it is counted in the statistics) and "off" flushes
+ *                  the buffer and restores the original functions.
+ */
+int lua_riot_stdout_buffer(lua_State *L)
+{
+    int policy = luaL_checkoption(L, 1, "block", policies);
+
+    if (policy != POLICY_OFF && drain_pid == KERNEL_PID_UNDEF) {
+        drain_pid = thread_create(drain_stack, sizeof(drain_stack),
+                                  LUA_STDOUT_PRIO, THREAD_CREATE_STACKTEST,
+                                  _drain_thread, NULL, "lua_stdout");
+        if (drain_pid < 0) {
+            drain_pid = KERNEL_PID_UNDEF;
+            return luaL_error(L, "Cannot start output thread");
+        }
+    }
+
+    if (policy == POLICY_OFF) {
+        lua_stdout_flush();
+    }
+
+    _install(L, policy != POLICY_OFF);
+    out_policy = policy;
+
+    return 0;
+}
+
+/**
+ * Wait until all buffered output has been written.
+ */
+int lua_riot_flush(lua_State *L)
+{
+    (void)L;
+
+    stats.flushes++;
+    lua_stdout_flush();
+
+    return 0;
+}
+
+/**
+ * Get the output buffer statistics.
+ *
+ * @return  Table with fields size, used, high_water (maximum used), written
+ *          (bytes), dropped (bytes), drops (number of discarded writes),
+ *          blocked (number of times the interpreter waited for space) and
+ *          flushes.
+ */
+int lua_riot_stdout_stats(lua_State *L)
+{
+    lua_createtable(L, 0, 8);
+
+    lua_pushinteger(L, LUA_STDOUT_BUF_SIZE);
+    lua_setfield(L, -2, "size");
+
+    lua_pushinteger(L, out_head - out_tail);
+    lua_setfield(L, -2, "used");
+
+    lua_pushinteger(L, stats.high_water);
+    lua_setfield(L, -2, "high_water");
+
+    lua_pushinteger(L, stats.written);
+    lua_setfield(L, -2, "written");
+
+    lua_pushinteger(L, stats.dropped);
+    lua_setfield(L, -2, "dropped");
+
+    lua_pushinteger(L, stats.drops);
+    lua_setfield(L, -2, "drops");
+
+    lua_pushinteger(L, stats.blocked);
+    lua_setfield(L, -2, "blocked");
+
+    lua_pushinteger(L, stats.flushes);
+    lua_setfield(L, -2, "flushes");
+
+    return 1;
+}
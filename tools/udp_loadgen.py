@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+
+# Copyright (C) 2026 agent
+#
+# This file is subject to the terms and conditions of the GNU Lesser
+# General Public License v2.1. See the file LICENSE in the top level
+# directory for more details.
+
+"""Load generator for the udpbench server (make LUA_MAIN=benchmain).
+
+Sweeps payload sizes and send rates. For each combination it runs an echo
+test (round trip latency, drops) and a sink test (throughput as seen by the
+device), and then asks the device for its counters, including Lua heap and
+GC activity.
+
+Example, with the node running on native on tap0:
+
+    ./tools/udp_loadgen.py fe80::xxxx%tap0 --sizes 16,256,1024 --rates 100,1000
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import threading
+import time
+
+HDR = struct.Struct("!cId")  # kind, sequence number, send time
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    k = min(len(sorted_values) - 1, int(round(p / 100 * (len(sorted_values) - 1))))
+    return sorted_values[k]
+
+
+def make_packet(kind, seq, size):
+    hdr = HDR.pack(kind, seq, time.monotonic())
+    return hdr + b"x" * max(0, size - len(hdr))
+
+
+def control(sock, addr, cmd, timeout=1.0):
+    """Send a control command and return the rest of the reply.
+
+    Replies start with the command itself, which no echo or late reply to
+    another command does.
+    """
+    sock.settimeout(timeout)
+    for _ in range(3):
+        sock.sendto(cmd, addr)
+        try:
+            while True:
+                data, _ = sock.recvfrom(2048)
+                if data == cmd or data.startswith(cmd + b" "):
+                    return data[len(cmd):].decode(errors="replace").strip()
+        except socket.timeout:
+            continue
+    return None
+
+
+def parse_stats(line):
+    if not line:
+        return {}
+    out = {}
+    for field in line.split():
+        k, _, v = field.partition("=")
+        try:
+            out[k] = float(v)
+        except ValueError:
+            out[k] = v
+    return out
+
+
+def paced_send(sock, addr, kind, size, rate, duration):
+    """Send packets at the given rate (0 = as fast as possible)."""
+    period = 1.0 / rate if rate else 0
+    start = time.monotonic()
+    seq = 0
+    next_t = start
+    while time.monotonic() - start < duration:
+        sock.sendto(make_packet(kind, seq, size), addr)
+        seq += 1
+        if period:
+            next_t += period
+            delay = next_t - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+    return seq, time.monotonic() - start
+
+
+def echo_test(sock, addr, size, rate, duration, grace):
+    rtts = []
+    received = set()
+    stop = threading.Event()
+
+    def receiver():
+        sock.settimeout(0.05)
+        while not stop.is_set():
+            try:
+                data, _ = sock.recvfrom(65536)
+            except socket.timeout:
+                continue
+            now = time.monotonic()
+            if len(data) >= HDR.size and data[:1] == b"e":
+                _, seq, sent = HDR.unpack_from(data)
+                if seq not in received:
+                    received.add(seq)
+                    rtts.append(now - sent)
+
+    t = threading.Thread(target=receiver)
+    t.start()
+    sent, elapsed = paced_send(sock, addr, b"e", size, rate, duration)
+    time.sleep(grace)
+    stop.set()
+    t.join()
+
+    rtts.sort()
+    return {
+        "sent": sent,
+        "recv": len(received),
+        "drops": sent - len(received),
+        "pps": len(received) / elapsed,
+        "p50_ms": percentile(rtts, 50) * 1e3,
+        "p90_ms": percentile(rtts, 90) * 1e3,
+        "p99_ms": percentile(rtts, 99) * 1e3,
+        "max_ms": (rtts[-1] if rtts else float("nan")) * 1e3,
+    }
+
+
+def sink_test(sock, addr, size, rate, duration, grace):
+    control(sock, addr, b"!reset")
+    sent, _ = paced_send(sock, addr, b"s", size, rate, duration)
+    time.sleep(grace)
+    st = parse_stats(control(sock, addr, b"!stats"))
+    got = int(st.get("sink_pkts", 0))
+    span = (st.get("last_us", 0) - st.get("first_us", 0)) / 1e6
+    return {
+        "sent": sent,
+        "recv": got,
+        "drops": sent - got,
+        "pps": got / span if span > 0 else float("nan"),
+        "kbit_s": st.get("sink_bytes", 0) * 8 / 1e3 / span if span > 0 else float("nan"),
+        "stats": st,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host", help="Node address, e.g. fe80::1%%tap0")
+    parser.add_argument("--port", type=int, default=9000)
+    parser.add_argument("--sizes", default="16,64,256,1024",
+                        help="Comma separated payload sizes in bytes")
+    parser.add_argument("--rates", default="100,500,1000,0",
+                        help="Comma separated send rates in packets/s (0 = unlimited)")
+    parser.add_argument("--duration", type=float, default=5.0,
+                        help="Seconds per test")
+    parser.add_argument("--grace", type=float, default=0.5,
+                        help="Seconds to wait for late packets")
+    args = parser.parse_args()
+
+    info = socket.getaddrinfo(args.host, args.port, socket.AF_INET6, socket.SOCK_DGRAM)
+    addr = info[0][4]
+    sock = socket.socket(socket.AF_INET6, socket.SOCK_DGRAM)
+
+    if control(sock, addr, b"!stats") is None:
+        sys.exit("No answer from %s port %d" % (args.host, args.port))
+
+    print("%5s %6s | %7s %6s %8s %8s %8s %8s | %7s %6s %8s %8s | %8s %8s %5s"
+          % ("size", "rate", "echo", "drops", "p50 ms", "p90 ms", "p99 ms", "max ms",
+             "sink", "drops", "pkt/s", "kbit/s", "heap kB", "max kB", "gc"))
+
+    for size in (int(s) for s in args.sizes.split(",")):
+        for rate in (int(r) for r in args.rates.split(",")):
+            e = echo_test(sock, addr, size, rate, args.duration, args.grace)
+            s = sink_test(sock, addr, size, rate, args.duration, args.grace)
+            st = s["stats"]
+            print("%5d %6s | %7.1f %6d %8.2f %8.2f %8.2f %8.2f | %7d %6d %8.1f %8.1f | %8.1f %8.1f %5d"
+                  % (size, rate or "max", e["pps"], e["drops"], e["p50_ms"], e["p90_ms"],
+                     e["p99_ms"], e["max_ms"], s["recv"], s["drops"], s["pps"],
+                     s["kbit_s"], st.get("heap_kb", 0), st.get("heap_max_kb", 0),
+                     st.get("gc_cycles", 0)))
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,875 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @ingroup     lua
+ * @{
+ *
+ * @file
+ * @brief       Persistent time series log for SAUL readings.
+ *
+ * Samples are stored as fixed-width records, keyed by a hash of the device
+ * name. Besides the raw samples, the log keeps two downsampled tiers (per
+ * minute and per hour) with min/max/mean.
+ *
+ * Each tier is a ring of records. The storage lives outside the Lua heap:
+ * either in a static RAM buffer (TSLOG_BACKEND=ram, survives interpreter
+ * restarts) or in files on a littlefs filesystem on the board's first MTD
+ * device (TSLOG_BACKEND=vfs, survives reboots). The module is only built when
+ * a backend is selected (LUA_TSLOG is defined).
+ *
+ * Timestamps are seconds since boot, so every record also carries a boot
+ * number that is incremented each time the storage is opened. Buckets never
+ * span two boots.
+ *
+ * To limit flash wear, the headers and the open buckets are only written
+ * every TSLOG_SYNC_EVERY records, on tslog.flush() and when the interpreter is
+ * closed. After a power failure, up to that many records can be lost.
+ *
+ * The filesystem is never formatted automatically, unless TSLOG_AUTOFORMAT is
+ * defined. Use tslog.format() instead.
+ *
+ * @author      agent <agent@local>
+ *
+ * @}
+ */
+
+#ifdef LUA_TSLOG
+
+#define LUA_LIB
+
+#include "lprefix.h"
+
+#include "saul_reg.h"
+#include "xtimer.h"
+#include "lua_saul.h"
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MODULE_LITTLEFS
+#include <fcntl.h>
+#include "board.h"
+#include "vfs.h"
+#include "fs/littlefs_fs.h"
+#endif
+
+#define TSLOG_QUERY_TNAME "tslog_query"
+
+#ifndef TSLOG_RAW_LEN
+#define TSLOG_RAW_LEN (256)
+#endif
+
+#ifndef TSLOG_MINUTE_LEN
+#define TSLOG_MINUTE_LEN (120)
+#endif
+
+#ifndef TSLOG_HOUR_LEN
+#define TSLOG_HOUR_LEN (72)
+#endif
+
+/* Maximum number of devices with an open downsampling bucket. */
+#ifndef TSLOG_MAX_DEVS
+#define TSLOG_MAX_DEVS (8)
+#endif
+
+/* Default number of records returned by each call to a query iterator. */
+#ifndef TSLOG_CHUNK
+#define TSLOG_CHUNK (16)
+#endif
+
+enum TSLOG_TIER { TIER_RAW, TIER_MINUTE, TIER_HOUR, TIER_NUMOF };
+
+/* Number of records appended between header writes. */
+#ifndef TSLOG_SYNC_EVERY
+#define TSLOG_SYNC_EVERY (16)
+#endif
+
+#ifndef TSLOG_VFS_DIR
+#define TSLOG_VFS_DIR "/tslog"
+#endif
+
+#define TSLOG_MAGIC (0x544c4732) /* "TLG2" */
+
+#define GUARD_KEY "_tslog_guard"
+
+/**
+ * On-storage record. Raw samples have count == 1 and min == max == mean.
+ */
+typedef struct {
+    uint32_t time;      /**< Seconds since boot. Start of the bucket for
+                             downsampled tiers */
+    uint32_t dev;       /**< Hash of the device name */
+    uint16_t boot;      /**< Boot number */
+    uint16_t count;     /**< Number of samples summarized by this record */
+    float min;
+    float max;
+    float mean;
+} tslog_rec_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t head;      /**< Total number of records ever written */
+    uint32_t boot;      /**< Boot number of the last time the log was opened */
+} tslog_hdr_t;
+
+/* Open downsampling bucket */
+typedef struct {
+    uint32_t bucket;
+    uint32_t dev;
+    uint16_t count;
+    float min;
+    float max;
+    float sum;
+} tslog_acc_t;
+
+/* Open buckets of all tiers, saved together with the headers. */
+typedef struct {
+    uint32_t magic;
+    uint32_t boot;      /**< Boot number the buckets belong to */
+    tslog_acc_t acc[TIER_NUMOF][TSLOG_MAX_DEVS];
+} tslog_open_t;
+
+struct tier_desc {
+    const char *name;
+    uint32_t period;    /**< Bucket length in seconds (0 for raw samples) */
+    uint32_t len;       /**< Capacity in records */
+};
+
+static const struct tier_desc tiers[TIER_NUMOF] = {
+    { "raw", 0, TSLOG_RAW_LEN },
+    { "minute", 60, TSLOG_MINUTE_LEN },
+    { "hour", 3600, TSLOG_HOUR_LEN },
+};
+
+static tslog_hdr_t headers[TIER_NUMOF];
+static tslog_open_t open_buckets;
+static unsigned unsynced;
+static bool initialized;
+
+/*********************** storage backends ***********************/
+
+#ifdef MODULE_LITTLEFS
+
+static littlefs_desc_t fs_desc = {
+    .lock = MUTEX_INIT,
+};
+
+static vfs_mount_t flash_mount = {
+    .fs = &littlefs_file_system,
+    .mount_point = TSLOG_VFS_DIR,
+    .private_data = &fs_desc,
+};
+
+static int fds[TIER_NUMOF];
+static int open_fd = -1;
+
+static int _pread(int fd, void *buf, size_t n, off_t off)
+{
+    if (vfs_lseek(fd, off, SEEK_SET) < 0) {
+        return -1;
+    }
+
+    return (vfs_read(fd, buf, n) == (ssize_t)n) ? 0 : -1;
+}
+
+static int _pwrite(int fd, const void *buf, size_t n, off_t off)
+{
+    if (vfs_lseek(fd, off, SEEK_SET) < 0) {
+        return -1;
+    }
+
+    return (vfs_write(fd, buf, n) == (ssize_t)n) ? 0 : -1;
+}
+
+static int _backend_init(void)
+{
+    unsigned int i;
+    char path[sizeof(TSLOG_VFS_DIR) + 8];
+
+    fs_desc.dev = MTD_0;
+
+    if (vfs_mount(&flash_mount) < 0) {
+#ifdef TSLOG_AUTOFORMAT
+        if (vfs_format(&flash_mount) < 0 || vfs_mount(&flash_mount) < 0) {
+            return -1;
+        }
+#else
+        return -1;
+#endif
+    }
+
+    for (i = 0; i < TIER_NUMOF; i++) {
+        snprintf(path, sizeof(path), TSLOG_VFS_DIR "/%s", tiers[i].name);
+
+        fds[i] = vfs_open(path, O_CREAT | O_RDWR, 0);
+        if (fds[i] < 0) {
+            return -1;
+        }
+
+        if (_pread(fds[i], &headers[i], sizeof(headers[i]), 0) < 0
+            || headers[i].magic != TSLOG_MAGIC) {
+            headers[i].magic = TSLOG_MAGIC;
+            headers[i].head = 0;
+            headers[i].boot = 0;
+        }
+    }
+
+    open_fd = vfs_open(TSLOG_VFS_DIR "/open", O_CREAT | O_RDWR, 0);
+    if (open_fd < 0) {
+        return -1;
+    }
+
+    if (_pread(open_fd, &open_buckets, sizeof(open_buckets), 0) < 0) {
+        open_buckets.magic = 0;
+    }
+
+    return 0;
+}
+
+static int _backend_format(void)
+{
+    unsigned int i;
+
+    if (initialized) {
+        for (i = 0; i < TIER_NUMOF; i++) {
+            vfs_close(fds[i]);
+        }
+        vfs_close(open_fd);
+        vfs_umount(&flash_mount);
+    }
+
+    fs_desc.dev = MTD_0;
+
+    return vfs_format(&flash_mount);
+}
+
+static int _backend_read(unsigned tier, uint32_t slot, tslog_rec_t *rec)
+{
+    return _pread(fds[tier], rec, sizeof(*rec),
+                  sizeof(tslog_hdr_t) + slot * sizeof(*rec));
+}
+
+static int _backend_write(unsigned tier, uint32_t slot, const tslog_rec_t *rec)
+{
+    return _pwrite(fds[tier], rec, sizeof(*rec),
+                   sizeof(tslog_hdr_t) + slot * sizeof(*rec));
+}
+
+static int _backend_sync(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < TIER_NUMOF; i++) {
+        if (_pwrite(fds[i], &headers[i], sizeof(headers[i]), 0) < 0
+            || vfs_fsync(fds[i]) < 0) {
+            return -1;
+        }
+    }
+
+    if (_pwrite(open_fd, &open_buckets, sizeof(open_buckets), 0) < 0) {
+        return -1;
+    }
+
+    return vfs_fsync(open_fd);
+}
+
+#else /* MODULE_LITTLEFS */
+
+static tslog_rec_t raw_store[TSLOG_RAW_LEN];
+static tslog_rec_t minute_store[TSLOG_MINUTE_LEN];
+static tslog_rec_t hour_store[TSLOG_HOUR_LEN];
+
+static tslog_rec_t *const stores[TIER_NUMOF] = {
+    raw_store, minute_store, hour_store
+};
+
+static int _backend_init(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < TIER_NUMOF; i++) {
+        headers[i].magic = TSLOG_MAGIC;
+        headers[i].head = 0;
+        headers[i].boot = 0;
+    }
+
+    return 0;
+}
+
+static int _backend_format(void)
+{
+    return 0;
+}
+
+static int _backend_read(unsigned tier, uint32_t slot, tslog_rec_t *rec)
+{
+    *rec = stores[tier][slot];
+
+    return 0;
+}
+
+static int _backend_write(unsigned tier, uint32_t slot, const tslog_rec_t *rec)
+{
+    stores[tier][slot] = *rec;
+
+    return 0;
+}
+
+static int _backend_sync(void)
+{
+    return 0;
+}
+
+#endif /* MODULE_LITTLEFS */
+
+/*********************** log operations ***********************/
+
+static int _append(unsigned tier, const tslog_rec_t *rec)
+{
+    tslog_hdr_t *h = &headers[tier];
+
+    if (_backend_write(tier, h->head % tiers[tier].len, rec) < 0) {
+        return -1;
+    }
+
+    h->head++;
+
+    if (++unsynced >= TSLOG_SYNC_EVERY) {
+        unsynced = 0;
+        return _backend_sync();
+    }
+
+    return 0;
+}
+
+/**
+ * Get (or allocate) the open bucket of a device in a downsampled tier.
+ *
+ * If all slots are taken, the one with the oldest bucket is evicted (and
+ * written out).
+ */
+static tslog_acc_t *_get_acc(unsigned tier, uint32_t dev)
+{
+    unsigned int i;
+    tslog_acc_t *free_slot = NULL, *victim = &open_buckets.acc[tier][0];
+
+    for (i = 0; i < TSLOG_MAX_DEVS; i++) {
+        tslog_acc_t *a = &open_buckets.acc[tier][i];
+
+        if (a->count == 0) {
+            free_slot = (free_slot == NULL) ? a : free_slot;
+        } else if (a->dev == dev) {
+            return a;
+        } else if (a->bucket < victim->bucket) {
+            victim = a;
+        }
+    }
+
+    return (free_slot != NULL) ? free_slot : victim;
+}
+
+static int _flush_acc(unsigned tier, tslog_acc_t *a)
+{
+    tslog_rec_t rec = {
+        .time = a->bucket, .dev = a->dev, .boot = open_buckets.boot,
+        .count = a->count, .min = a->min, .max = a->max,
+        .mean = a->sum / a->count
+    };
+
+    a->count = 0;
+
+    return _append(tier, &rec);
+}
+
+static int _log_sample(uint32_t dev, uint32_t t, float value)
+{
+    unsigned int tier;
+    tslog_rec_t rec = {
+        .time = t, .dev = dev, .boot = open_buckets.boot, .count = 1,
+        .min = value, .max = value, .mean = value
+    };
+
+    if (_append(TIER_RAW, &rec) < 0) {
+        return -1;
+    }
+
+    for (tier = TIER_RAW + 1; tier < TIER_NUMOF; tier++) {
+        uint32_t bucket = t - t % tiers[tier].period;
+        tslog_acc_t *a = _get_acc(tier, dev);
+
+        if (a->count != 0 && (a->dev != dev || a->bucket != bucket)) {
+            if (_flush_acc(tier, a) < 0) {
+                return -1;
+            }
+        }
+
+        if (a->count == 0) {
+            a->dev = dev;
+            a->bucket = bucket;
+            a->min = FLT_MAX;
+            a->max = -FLT_MAX;
+            a->sum = 0;
+        }
+
+        a->count++;
+        a->sum += value;
+        if (value < a->min) {
+            a->min = value;
+        }
+        if (value > a->max) {
+            a->max = value;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Open the storage and start a new boot.
+ *
+ * Buckets left open by the previous boot are complete, so they are written
+ * out.
+ */
+static int _open_log(void)
+{
+    unsigned int tier, i;
+    uint32_t boot = 0;
+
+    if (_backend_init() < 0) {
+        return -1;
+    }
+
+    for (tier = 0; tier < TIER_NUMOF; tier++) {
+        if (headers[tier].boot > boot) {
+            boot = headers[tier].boot;
+        }
+    }
+    boot = (boot + 1) & UINT16_MAX;
+
+    if (open_buckets.magic == TSLOG_MAGIC) {
+        for (tier = TIER_RAW + 1; tier < TIER_NUMOF; tier++) {
+            for (i = 0; i < TSLOG_MAX_DEVS; i++) {
+                tslog_acc_t *a = &open_buckets.acc[tier][i];
+
+                if (a->count != 0 && _flush_acc(tier, a) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    memset(&open_buckets, 0, sizeof(open_buckets));
+    open_buckets.magic = TSLOG_MAGIC;
+    open_buckets.boot = boot;
+
+    for (tier = 0; tier < TIER_NUMOF; tier++) {
+        headers[tier].boot = boot;
+    }
+
+    unsynced = 0;
+
+    return _backend_sync();
+}
+
+/*********************** lua interface ***********************/
+
+static void _check_init(lua_State *L)
+{
+    if (!initialized) {
+        if (_open_log() < 0) {
+            luaL_error(L, "Cannot open storage (see tslog.format)");
+        }
+        initialized = true;
+    }
+}
+
+/**
+ * Get the key of a device: a hash of its name (FNV-1a).
+ *
+ * Unlike the position in the registry, this does not change when devices are
+ * added or removed from the build.
+ */
+static uint32_t _dev2key(lua_State *L, int arg)
+{
+    saul_reg_t *dev = lua_saul_checkdev(L, arg);
+    const char *name = (dev->name != NULL) ? dev->name : "";
+    uint32_t h = 2166136261u;
+
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+
+    return h;
+}
+
+static uint32_t _opt_time(lua_State *L, int arg)
+{
+    if (lua_isnoneornil(L, arg)) {
+        return xtimer_now_usec64() / US_PER_SEC;
+    } else {
+        return luaL_checkinteger(L, arg);
+    }
+}
+
+static unsigned _check_tier(lua_State *L, int arg)
+{
+    const char *name = luaL_optstring(L, arg, tiers[TIER_RAW].name);
+    unsigned int i;
+
+    for (i = 0; i < TIER_NUMOF; i++) {
+        if (!strcmp(name, tiers[i].name)) {
+            return i;
+        }
+    }
+
+    return luaL_argerror(L, arg, "Unknown tier");
+}
+
+static int _push_result(lua_State *L, int status)
+{
+    if (status < 0) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "Storage error");
+        return 2;
+    }
+
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+/**
+ * Append a sample to the log.
+ *
+ * @param   dev     SAUL device object.
+ * @param   value   Number.
+ * @param   t       (optional) Timestamp in seconds. Defaults to the time since
+ *                  boot.
+ *
+ * @return  true, or nil and an error message.
+ */
+static int tslog_append(lua_State *L)
+{
+    uint32_t dev = _dev2key(L, 1);
+    float value = luaL_checknumber(L, 2);
+    uint32_t t = _opt_time(L, 3);
+
+    _check_init(L);
+
+    return _push_result(L, _log_sample(dev, t, value));
+}
+
+/**
+ * Read a device and log its first value.
+ *
+ * The reading never enters the interpreter, so this is cheaper than reading
+ * the device and calling append.
+ *
+ * @param   dev     SAUL device object.
+ * @param   t       (optional) Timestamp in seconds.
+ *
+ * @return  The value that was logged, or nil and an error message.
+ */
+static int tslog_sample(lua_State *L)
+{
+    saul_reg_t *d = lua_saul_checkdev(L, 1);
+    uint32_t dev = _dev2key(L, 1);
+    uint32_t t = _opt_time(L, 2);
+    phydat_t data;
+    float value;
+    int nread;
+
+    _check_init(L);
+
+    data.scale = 0;
+    nread = saul_reg_read(d, &data);
+    if (nread <= 0) {
+        lua_pushnil(L);
+        lua_pushfstring(L, "error %d", nread);
+        return 2;
+    }
+
+    lua_saul_phydat2float(&data, 1, &value);
+
+    if (_log_sample(dev, t, value) < 0) {
+        return _push_result(L, -1);
+    }
+
+    lua_pushnumber(L, value);
+    return 1;
+}
+
+struct tslog_query {
+    uint32_t pos;       /**< Next record to examine (absolute index) */
+    uint32_t t0;
+    uint32_t t1;
+    uint32_t dev;
+    int32_t boot;       /**< -1 for any */
+    uint8_t tier;
+    uint16_t chunk;
+};
+
+/**
+ * Iterator returned by query.
+ *
+ * Each call returns a table with up to "chunk" records, or nil when there are
+ * no more records. Records are tables with fields time, boot, min, max, mean
+ * and count.
+ */
+static int _query_next(lua_State *L)
+{
+    struct tslog_query *q = luaL_checkudata(L, lua_upvalueindex(1),
+                                            TSLOG_QUERY_TNAME);
+    const tslog_hdr_t *h = &headers[q->tier];
+    uint32_t len = tiers[q->tier].len;
+    int n = 0;
+
+    /* Records may have been overwritten since the last call */
+    if (h->head > len && q->pos < h->head - len) {
+        q->pos = h->head - len;
+    }
+
+    lua_createtable(L, q->chunk, 0);
+
+    while (n < q->chunk && q->pos < h->head) {
+        tslog_rec_t rec;
+
+        if (_backend_read(q->tier, q->pos % len, &rec) < 0) {
+            return luaL_error(L, "Storage error");
+        }
+        q->pos++;
+
+        if (rec.dev != q->dev || rec.time < q->t0 || rec.time > q->t1
+            || (q->boot >= 0 && rec.boot != q->boot)) {
+            continue;
+        }
+
+        lua_createtable(L, 0, 6);
+        lua_pushinteger(L, rec.time);
+        lua_setfield(L, -2, "time");
+        lua_pushinteger(L, rec.boot);
+        lua_setfield(L, -2, "boot");
+        lua_pushnumber(L, rec.min);
+        lua_setfield(L, -2, "min");
+        lua_pushnumber(L, rec.max);
+        lua_setfield(L, -2, "max");
+        lua_pushnumber(L, rec.mean);
+        lua_setfield(L, -2, "mean");
+        lua_pushinteger(L, rec.count);
+        lua_setfield(L, -2, "count");
+
+        lua_rawseti(L, -2, ++n);
+    }
+
+    if (n == 0) {
+        lua_pushnil(L);
+    }
+
+    return 1;
+}
+
+/**
+ * Query a range of records.
+ *
+ * @param   dev     SAUL device object.
+ * @param   tier    "raw", "minute" or "hour" (default "raw").
+ * @param   t0      (optional) Start time, inclusive.
+ * @param   t1      (optional) End time, inclusive.
+ * @param   chunk   (optional) Maximum number of records per iteration.
+ * @param   boot    (optional) Only return records from this boot (see
+ *                  tslog.boot). Default: the current one. -1 for all.
+ *
+ * @return  Iterator function, to be used in a generic for. See _query_next.
+ */
+static int tslog_query(lua_State *L)
+{
+    uint32_t dev = _dev2key(L, 1);
+    unsigned tier = _check_tier(L, 2);
+    lua_Integer t0 = luaL_optinteger(L, 3, 0);
+    lua_Integer t1 = luaL_optinteger(L, 4, UINT32_MAX);
+    lua_Integer chunk = luaL_optinteger(L, 5, TSLOG_CHUNK);
+    lua_Integer boot;
+    struct tslog_query *q;
+
+    luaL_argcheck(L, chunk > 0 && chunk <= UINT16_MAX, 5, "Invalid chunk size");
+    _check_init(L);
+
+    boot = luaL_optinteger(L, 6, open_buckets.boot);
+    luaL_argcheck(L, boot >= -1 && boot <= UINT16_MAX, 6, "Invalid boot number");
+
+    q = lua_newuserdata(L, sizeof(*q));
+    luaL_setmetatable(L, TSLOG_QUERY_TNAME);
+
+    q->dev = dev;
+    q->boot = boot;
+    q->tier = tier;
+    q->t0 = t0;
+    q->t1 = t1;
+    q->chunk = chunk;
+    q->pos = (headers[tier].head > tiers[tier].len) ?
+             headers[tier].head - tiers[tier].len : 0;
+
+    lua_pushcclosure(L, _query_next, 1);
+
+    return 1;
+}
+
+/**
+ * Get the number of records stored in each tier.
+ *
+ * @return  Table indexed by tier name.
+ */
+static int tslog_count(lua_State *L)
+{
+    unsigned int i;
+
+    _check_init(L);
+
+    lua_createtable(L, 0, TIER_NUMOF);
+
+    for (i = 0; i < TIER_NUMOF; i++) {
+        uint32_t head = headers[i].head;
+
+        lua_pushinteger(L, (head < tiers[i].len) ? head : tiers[i].len);
+        lua_setfield(L, -2, tiers[i].name);
+    }
+
+    return 1;
+}
+
+/**
+ * Get the current boot number.
+ */
+static int tslog_boot(lua_State *L)
+{
+    _check_init(L);
+
+    lua_pushinteger(L, open_buckets.boot);
+
+    return 1;
+}
+
+/**
+ * Write the headers and the open buckets to storage.
+ *
+ * This is also done every TSLOG_SYNC_EVERY records and when the interpreter
+ * is closed.
+ *
+ * @return  true, or nil and an error message.
+ */
+static int tslog_flush(lua_State *L)
+{
+    _check_init(L);
+
+    unsynced = 0;
+
+    return _push_result(L, _backend_sync());
+}
+
+/**
+ * Delete all records and open buckets.
+ */
+static int tslog_clear(lua_State *L)
+{
+    unsigned int i;
+
+    _check_init(L);
+
+    memset(open_buckets.acc, 0, sizeof(open_buckets.acc));
+
+    for (i = 0; i < TIER_NUMOF; i++) {
+        headers[i].head = 0;
+    }
+
+    unsynced = 0;
+
+    return _push_result(L, _backend_sync());
+}
+
+/**
+ * Format the storage and start an empty log.
+ *
+ * With the vfs backend this erases the whole MTD_0 device, including any
+ * other files on it.
+ *
+ * @return  true, or nil and an error message.
+ */
+static int tslog_format(lua_State *L)
+{
+    int status = _backend_format();
+
+    initialized = false;
+    open_buckets.magic = 0;
+
+    if (status < 0) {
+        return _push_result(L, -1);
+    }
+
+    _check_init(L);
+
+    return _push_result(L, 0);
+}
+
+/* Save the state when the interpreter is closed */
+static int _guard_gc(lua_State *L)
+{
+    (void)L;
+
+    if (initialized) {
+        unsynced = 0;
+        _backend_sync();
+    }
+
+    return 0;
+}
+
+static const luaL_Reg funcs[] = {
+  {"append", tslog_append},
+  {"sample", tslog_sample},
+  {"query", tslog_query},
+  {"count", tslog_count},
+  {"boot", tslog_boot},
+  {"flush", tslog_flush},
+  {"clear", tslog_clear},
+  {"format", tslog_format},
+  {NULL, NULL}
+};
+
+/**
+ * Load the library.
+ *
+ * @return      Lua table.
+ */
+int luaopen_tslog(lua_State *L)
+{
+    luaL_newmetatable(L, TSLOG_QUERY_TNAME);
+    lua_pop(L, 1);
+
+    /* A userdata in the registry that is collected when the state closes */
+    if (lua_getfield(L, LUA_REGISTRYINDEX, GUARD_KEY) == LUA_TNIL) {
+        lua_newuserdata(L, 1);
+        lua_createtable(L, 0, 1);
+        lua_pushcfunction(L, _guard_gc);
+        lua_setfield(L, -2, "__gc");
+        lua_setmetatable(L, -2);
+        lua_setfield(L, LUA_REGISTRYINDEX, GUARD_KEY);
+    }
+    lua_pop(L, 1);
+
+    luaL_newlib(L, funcs);
+
+    return 1;
+}
+
+#endif /* LUA_TSLOG */
@@ -0,0 +1,92 @@
+--[[
+   @file udatabench.lua
+   @brief   Per-call cost of the methods of the C userdata types.
+   @author  agent <agent@local>
+   Copyright (C) 2026 agent. Distributed under the GNU Lesser General Public License v2.1.
+
+   Times every method of saul_dev and sock_udp objects, and the type check
+   alone both against the upvalue and with luaL_checkudata, to report the
+   savings per call. Usage:
+
+       L> require"udatabench".run(1000)
+
+   Times are reported in microseconds per call, with the loop overhead
+   subtracted.
+]]
+
+local riot = require"riot"
+local saul = require"saul"
+local socket = require"socket"
+
+local function timeit(n, f, ...)
+    local t0 = riot.now_us()
+    for _ = 1, n do
+        f(...)
+    end
+    return (riot.now_us() - t0) / n
+end
+
+local function nop() end
+
+local function report(results, name, t)
+    results[name] = t
+    print(string.format("%-24s %10.3f us", name, t))
+end
+
+local function run(n)
+    n = n or 1000
+
+    local results = {}
+    local overhead = timeit(n, nop)
+
+    report(results, "(loop overhead)", overhead)
+
+    local sensor = saul.find_type("SENSE_ANY") or saul.find_type("SENSE_LIGHT")
+                   or saul.find_type("SENSE_ANALOG")
+    local actuator = saul.find_type("ACT_SERVO") or saul.find_type("ACT_ANY")
+
+    if sensor then
+        local up = timeit(n, saul._bench_check_up, sensor)
+        local registry = timeit(n, saul._bench_check_registry, sensor)
+
+        report(results, "check (upvalue)", up - overhead)
+        report(results, "check (registry)", registry - overhead)
+        report(results, "check savings", registry - up)
+
+        report(results, "saul_dev:get_name",
+               timeit(n, sensor.get_name, sensor) - overhead)
+        report(results, "saul_dev:get_type",
+               timeit(n, sensor.get_type, sensor) - overhead)
+        report(results, "saul_dev:read",
+               timeit(n, sensor.read, sensor) - overhead)
+    end
+
+    if actuator then
+        report(results, "saul_dev:write",
+               timeit(n, actuator.write, actuator, 1500) - overhead)
+        report(results, "saul_dev:busy",
+               timeit(n, actuator.busy, actuator) - overhead)
+    end
+
+    local u = socket.udp({address="::", port=12345})
+    if u then
+        local dst = {address="::1", port=9}
+
+        report(results, "sock_udp:recv",
+               timeit(n, u.recv, u, 16, 0) - overhead)
+        report(results, "sock_udp:send",
+               timeit(n, u.send, u, "x", dst) - overhead)
+        u:close()
+
+        local t0 = riot.now_us()
+        for _ = 1, n do
+            socket.udp():close()
+        end
+        report(results, "udp() + sock_udp:close",
+               (riot.now_us() - t0) / n - overhead)
+    end
+
+    return results
+end
+
+return {run = run}
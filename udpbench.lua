@@ -0,0 +1,133 @@
+--[[
+   @file udpbench.lua
+   @brief   UDP echo/sink server for throughput and latency measurements.
+   @author  agent <agent@local>
+   Copyright (C) 2026 agent. Distributed under the GNU Lesser General Public License v2.1.
+
+   Both servers share a socket. The first byte of each datagram selects what
+   to do with it:
+
+       "e"     echo: the datagram is sent back unchanged.
+       "s"     sink: the datagram is counted and discarded.
+       "!"     control: "!stats" replies with the counters, "!reset" clears
+               them and "!quit" stops the server. Replies start with the
+               command, so that they cannot be mistaken for echoes.
+
+   See tools/udp_loadgen.py for the matching load generator.
+]]
+
+local riot = require"riot"
+local socket = require"socket"
+
+local ECHO = ("e"):byte()
+local SINK = ("s"):byte()
+local CONTROL = ("!"):byte()
+
+-- Sample the heap size every this many packets.
+local HEAP_SAMPLE = 32
+
+local function new_stats()
+    return {
+        echo_pkts = 0, echo_bytes = 0, echo_errors = 0,
+        sink_pkts = 0, sink_bytes = 0,
+        recv_errors = 0,
+        first_us = 0, last_us = 0,
+        heap_kb = collectgarbage("count"), heap_max_kb = 0,
+        gc_cycles = 0,
+    }
+end
+
+local function stats_line(st)
+    local heap = collectgarbage("count")
+    local fields = {}
+    st.heap_kb = heap
+    for k, v in pairs(st) do
+        fields[#fields+1] = k.."="..v
+    end
+    table.sort(fields)
+    return table.concat(fields, " ")
+end
+
+local function sample_heap(st)
+    local heap = collectgarbage("count")
+    -- The heap only shrinks when the collector finishes a cycle.
+    if heap < st.heap_kb then
+        st.gc_cycles = st.gc_cycles + 1
+    end
+    if heap > st.heap_max_kb then
+        st.heap_max_kb = heap
+    end
+    st.heap_kb = heap
+end
+
+--[[ Run the servers.
+    @param port     UDP port (default 9000).
+    @param maxlen   Maximum datagram size (default 1024).
+]]
+local function serve(port, maxlen)
+    port = port or 9000
+    maxlen = maxlen or 1024
+
+    local u, err = socket.udp({address="::", port=port})
+    if not u then
+        print("Cannot create socket: "..err)
+        return 1
+    end
+
+    print("udpbench listening on port "..port)
+
+    local st = new_stats()
+    local remote = {}
+    local n = 0
+
+    while true do
+        local data = u:recv(maxlen, -1, remote)
+
+        if not data then
+            st.recv_errors = st.recv_errors + 1
+        else
+            local kind = data:byte(1)
+            local now = riot.now_us()
+
+            if kind == ECHO then
+                if u:send(data, remote) then
+                    st.echo_pkts = st.echo_pkts + 1
+                    st.echo_bytes = st.echo_bytes + #data
+                else
+                    st.echo_errors = st.echo_errors + 1
+                end
+            elseif kind == SINK then
+                st.sink_pkts = st.sink_pkts + 1
+                st.sink_bytes = st.sink_bytes + #data
+            elseif kind == CONTROL then
+                if data == "!stats" then
+                    u:send("!stats "..stats_line(st), remote)
+                elseif data == "!reset" then
+                    st = new_stats()
+                    now = 0
+                    u:send("!reset", remote)
+                elseif data == "!quit" then
+                    u:send("!quit", remote)
+                    break
+                end
+            end
+
+            if now ~= 0 then
+                if st.first_us == 0 then
+                    st.first_us = now
+                end
+                st.last_us = now
+            end
+
+            n = n + 1
+            if n % HEAP_SAMPLE == 0 then
+                sample_heap(st)
+            end
+        end
+    end
+
+    u:close()
+    return 0
+end
+
+return {serve = serve}